@@ -20,5 +20,15 @@
 
 from __future__ import absolute_import
 
-from ._gi import _API
+from ._gi import _API, trim_free_lists, set_closure_pool_capacity
+from ._gi import set_struct_arrays_enabled
+from ._gi import fields_as_tuple, fields_as_dict, fields_update
+from ._gi import Steal as steal
+from ._gi import Queued as queued, dispatch_pending
+from ._gi import _stats, set_stats_enabled
 
+from .warmup import prewarm
+
+
+from . import trace
+trace._start_from_environment()
@@ -22,6 +22,7 @@
  */
 
 #include "pygi-private.h"
+#include "pygi-marshal-api.h"
 
 #include <pygobject.h>
 
@@ -33,45 +34,16 @@ _wrap_pyg_enum_add (PyObject *self,
                     PyObject *args,
                     PyObject *kwargs)
 {
-    static char *kwlist[] = { "g_type", NULL };
-    PyObject *py_g_type;
-    GType g_type;
+    static char *kwlist[] = { "info", NULL };
+    PyObject *py_info;
 
     if (!PyArg_ParseTupleAndKeywords(args, kwargs,
                 "O!:enum_add",
-                kwlist, &PyGTypeWrapper_Type, &py_g_type)) {
-        return NULL;
-    }
-
-    g_type = pyg_type_from_object(py_g_type);
-    if (g_type == G_TYPE_INVALID) {
+                kwlist, &PyGIEnumInfo_Type, &py_info)) {
         return NULL;
     }
 
-    return pyg_enum_add(NULL, g_type_name(g_type), NULL, g_type);
-}
-
-static PyObject *
-_wrap_pyg_flags_add (PyObject *self,
-                     PyObject *args,
-                     PyObject *kwargs)
-{
-    static char *kwlist[] = { "g_type", NULL };
-    PyObject *py_g_type;
-    GType g_type;
-
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs,
-                "O!:flags_add",
-                kwlist, &PyGTypeWrapper_Type, &py_g_type)) {
-        return NULL;
-    }
-
-    g_type = pyg_type_from_object(py_g_type);
-    if (g_type == G_TYPE_INVALID) {
-        return NULL;
-    }
-
-    return pyg_flags_add(NULL, g_type_name(g_type), NULL, g_type);
+    return _pygi_enum_add(py_info);
 }
 
 static PyObject *
@@ -132,13 +104,179 @@ _wrap_pyg_register_interface_info(PyObject *self, PyObject *args)
     Py_RETURN_NONE;
 }
 
+static PyObject *
+_wrap_pyg_trim_free_lists (PyObject *self)
+{
+    return PyInt_FromSize_t(_pygi_closure_trim(0));
+}
+
+static PyObject *
+_wrap_pyg_set_closure_pool_capacity (PyObject *self,
+                                     PyObject *args,
+                                     PyObject *kwargs)
+{
+    static char *kwlist[] = { "capacity", NULL };
+    Py_ssize_t capacity;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs,
+                "n:set_closure_pool_capacity",
+                kwlist, &capacity)) {
+        return NULL;
+    }
+
+    if (capacity < 0) {
+        PyErr_SetString(PyExc_ValueError, "capacity must not be negative");
+        return NULL;
+    }
+
+    _pygi_closure_set_pool_capacity(capacity);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+_wrap_pyg_stats (PyObject *self,
+                 PyObject *args,
+                 PyObject *kwargs)
+{
+    static char *kwlist[] = { "reset", NULL };
+    PyObject *py_reset = Py_False;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O:_stats", kwlist, &py_reset)) {
+        return NULL;
+    }
+
+    return _pygi_stats_as_dict(PyObject_IsTrue(py_reset));
+}
+
+static PyObject *
+_wrap_pyg_set_stats_enabled (PyObject *self,
+                             PyObject *args,
+                             PyObject *kwargs)
+{
+    static char *kwlist[] = { "enabled", "histograms", NULL };
+    PyObject *py_enabled;
+    PyObject *py_histograms = Py_False;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O:set_stats_enabled", kwlist,
+            &py_enabled, &py_histograms)) {
+        return NULL;
+    }
+
+    _pygi_stats_enabled = PyObject_IsTrue(py_enabled);
+    _pygi_stats_histograms_enabled = _pygi_stats_enabled && PyObject_IsTrue(py_histograms);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+_wrap_pyg_set_struct_arrays_enabled (PyObject *self,
+                                     PyObject *args,
+                                     PyObject *kwargs)
+{
+    static char *kwlist[] = { "enabled", NULL };
+    PyObject *py_enabled;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O:set_struct_arrays_enabled", kwlist,
+            &py_enabled)) {
+        return NULL;
+    }
+
+    _pygi_struct_arrays_enabled = PyObject_IsTrue(py_enabled);
+
+    Py_RETURN_NONE;
+}
+
+/* The bulk field accessors are functions rather than methods of gi.Struct
+ * and gi.Boxed, where they would clash with introspected methods. */
+static PyObject *
+_wrap_pyg_fields_as_tuple (PyObject *self,
+                           PyObject *instance)
+{
+    return _pygi_fields_as_tuple(instance);
+}
+
+static PyObject *
+_wrap_pyg_fields_as_dict (PyObject *self,
+                          PyObject *instance)
+{
+    return _pygi_fields_as_dict(instance);
+}
+
+static PyObject *
+_wrap_pyg_fields_update (PyObject *self,
+                         PyObject *args,
+                         PyObject *kwargs)
+{
+    PyObject *py_values;
+    gint retval;
+
+    if (PyTuple_GET_SIZE(args) < 1) {
+        PyErr_SetString(PyExc_TypeError, "fields_update() takes at least 1 argument (0 given)");
+        return NULL;
+    }
+
+    py_values = PyTuple_GetSlice(args, 1, PyTuple_GET_SIZE(args));
+    if (py_values == NULL) {
+        return NULL;
+    }
+
+    retval = _pygi_fields_update(PyTuple_GET_ITEM(args, 0), py_values, kwargs);
+    Py_DECREF(py_values);
+    if (retval < 0) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+_wrap_pyg_start_trace (PyObject *self,
+                       PyObject *args)
+{
+    const gchar *filename;
+
+    if (!PyArg_ParseTuple(args, "s:_start_trace", &filename)) {
+        return NULL;
+    }
+
+    if (!_pygi_trace_start(filename)) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+_wrap_pyg_stop_trace (PyObject *self)
+{
+    return PyBool_FromLong(_pygi_trace_stop());
+}
+
+static PyObject *
+_wrap_pyg_dispatch_pending (PyObject *self)
+{
+    return PyInt_FromSize_t(_pygi_dispatch_pending());
+}
+
 
 static PyMethodDef _pygi_functions[] = {
     { "enum_add", (PyCFunction)_wrap_pyg_enum_add, METH_VARARGS | METH_KEYWORDS },
-    { "flags_add", (PyCFunction)_wrap_pyg_flags_add, METH_VARARGS | METH_KEYWORDS },
 
     { "set_object_has_new_constructor", (PyCFunction)_wrap_pyg_set_object_has_new_constructor, METH_VARARGS | METH_KEYWORDS },
     { "register_interface_info", (PyCFunction)_wrap_pyg_register_interface_info, METH_VARARGS },
+
+    { "trim_free_lists", (PyCFunction)_wrap_pyg_trim_free_lists, METH_NOARGS },
+    { "set_closure_pool_capacity", (PyCFunction)_wrap_pyg_set_closure_pool_capacity, METH_VARARGS | METH_KEYWORDS },
+    { "dispatch_pending", (PyCFunction)_wrap_pyg_dispatch_pending, METH_NOARGS },
+    { "_stats", (PyCFunction)_wrap_pyg_stats, METH_VARARGS | METH_KEYWORDS },
+    { "set_stats_enabled", (PyCFunction)_wrap_pyg_set_stats_enabled, METH_VARARGS | METH_KEYWORDS },
+    { "set_struct_arrays_enabled", (PyCFunction)_wrap_pyg_set_struct_arrays_enabled, METH_VARARGS | METH_KEYWORDS },
+    { "fields_as_tuple", (PyCFunction)_wrap_pyg_fields_as_tuple, METH_O },
+    { "fields_as_dict", (PyCFunction)_wrap_pyg_fields_as_dict, METH_O },
+    { "fields_update", (PyCFunction)_wrap_pyg_fields_update, METH_VARARGS | METH_KEYWORDS },
+    { "_start_trace", (PyCFunction)_wrap_pyg_start_trace, METH_VARARGS },
+    { "_stop_trace", (PyCFunction)_wrap_pyg_stop_trace, METH_NOARGS },
     { NULL, NULL, 0 }
 };
 
@@ -146,6 +284,12 @@ struct PyGI_API PyGI_API = {
     pygi_type_import_by_g_type
 };
 
+static struct PyGIMarshal_API PyGIMarshal_API = {
+    _pygi_argument_from_object,
+    _pygi_argument_to_object,
+    _pygi_argument_release
+};
+
 
 PyMODINIT_FUNC
 init_gi(void)
@@ -174,6 +318,11 @@ init_gi(void)
     _pygi_info_register_types(m);
     _pygi_struct_register_types(m);
     _pygi_boxed_register_types(m);
+    _pygi_field_register_types(m);
+    _pygi_buffer_register_types(m);
+    _pygi_steal_register_types(m);
+    _pygi_dispatch_register_types(m);
+    _pygi_async_register_types(m);
     _pygi_argument_init();
 
     api = PyCObject_FromVoidPtr((void *)&PyGI_API, NULL);
@@ -181,5 +330,13 @@ init_gi(void)
         return;
     }
     PyModule_AddObject(m, "_API", api);
+
+    api = PyCObject_FromVoidPtr((void *)&PyGIMarshal_API, NULL);
+    if (api == NULL) {
+        return;
+    }
+    PyModule_AddObject(m, "_marshal_API", api);
+
+    PyModule_AddIntConstant(m, "_PROBES_ENABLED", PYGI_PROBES_ENABLED);
 }
 
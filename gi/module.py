@@ -36,12 +36,12 @@ from ._gi import \
     StructInfo, \
     Struct, \
     Boxed, \
-    enum_add, \
-    flags_add
+    enum_add
 from .types import \
     GObjectMeta, \
     StructMeta, \
-    Function
+    Function, \
+    FutureFunction
 
 repository = Repository.get_default()
 
@@ -80,6 +80,17 @@ class DynamicModule(object):
 
     def __getattr__(self, name):
         info = repository.find_by_name(self._namespace, name)
+
+        # foo_future calls foo_async, which must have a foo_finish.
+        if not info and name.endswith('_future'):
+            prefix = name[:-len('_future')]
+            async_info = repository.find_by_name(self._namespace, prefix + '_async')
+            if isinstance(async_info, FunctionInfo) \
+                    and repository.find_by_name(self._namespace, prefix + '_finish'):
+                value = FutureFunction(async_info)
+                self.__dict__[name] = value
+                return value
+
         if not info:
             raise AttributeError("%r object has no attribute %r" % (
                     self.__class__.__name__, name))
@@ -89,17 +100,7 @@ class DynamicModule(object):
             value = g_type.pytype
 
             if value is None:
-                if g_type.is_a(gobject.TYPE_ENUM):
-                    value = enum_add(g_type)
-                else:
-                    value = flags_add(g_type)
-
-                value.__info__ = info
-                value.__module__ = info.get_namespace()
-
-                for value_info in info.get_values():
-                    name = value_info.get_name().upper()
-                    setattr(value, name, value(value_info.get_value()))
+                value = enum_add(info)
 
         elif isinstance(info, RegisteredTypeInfo):
             g_type = info.get_g_type()
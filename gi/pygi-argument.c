@@ -166,6 +166,10 @@ _pygi_g_registered_type_info_check_object (GIRegisteredTypeInfo *info,
 
     Py_DECREF(py_type);
 
+    if (retval > 0 && is_instance && !_pygi_steal_check_not_consumed(object)) {
+        return -1;
+    }
+
     if (!retval) {
         PyTypeObject *object_type;
 
@@ -380,7 +384,14 @@ check_number_release:
 
             switch (info_type) {
                 case GI_INFO_TYPE_CALLBACK:
-                    if (!PyCallable_Check(object)) {
+                    /* Capsules hold native functions, whose name is
+                     * checked against the callback when it is passed. */
+                    if (!PyCallable_Check(object)
+                            && !_pygi_native_callback_check(object)
+#if PY_VERSION_HEX >= 0x02070000
+                            && !PyCapsule_CheckExact(object)
+#endif
+                            ) {
                         PyErr_Format(PyExc_TypeError, "Must be callable, not %s",
                                 object->ob_type->tp_name);
                         retval = 0;
@@ -1351,14 +1362,25 @@ _pygi_argument_to_object (GArgument  *arg,
 
             array = arg->v_pointer;
 
+            item_type_info = g_type_info_get_param_type(type_info, 0);
+            g_assert(item_type_info != NULL);
+
+            /* Arrays of simple structures are kept in one block, when asked
+             * for; they are not tuples. */
+            if (_pygi_struct_arrays_enabled) {
+                object = _pygi_struct_array_from_g_array(array, item_type_info);
+                if (object != NULL || PyErr_Occurred()) {
+                    g_base_info_unref((GIBaseInfo *)item_type_info);
+                    break;
+                }
+            }
+
             object = PyTuple_New(array->len);
             if (object == NULL) {
+                g_base_info_unref((GIBaseInfo *)item_type_info);
                 break;
             }
 
-            item_type_info = g_type_info_get_param_type(type_info, 0);
-            g_assert(item_type_info != NULL);
-
             item_type_tag = g_type_info_get_tag(item_type_info);
             item_transfer = transfer == GI_TRANSFER_CONTAINER ? GI_TRANSFER_NOTHING : transfer;
             item_size = g_array_get_element_size(array);
@@ -1481,11 +1503,8 @@ _pygi_argument_to_object (GArgument  *arg,
 
                     type = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *)info);
 
-                    if (info_type == GI_INFO_TYPE_ENUM) {
-                        object = pyg_enum_from_gtype(type, arg->v_long);
-                    } else {
-                        object = pyg_flags_from_gtype(type, arg->v_long);
-                    }
+                    object = _pygi_enum_from_g_type(type, arg->v_long,
+                            info_type == GI_INFO_TYPE_FLAGS);
 
                     break;
                 }
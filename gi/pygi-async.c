@@ -0,0 +1,679 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-async.c: futures for asynchronous functions.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <pygobject.h>
+
+/* The _finish sibling of foo_async is foo_finish, either a method of the
+ * same type or a function of the same namespace. */
+static PyObject *
+_pygi_future_find_finish_info (GIFunctionInfo *info)
+{
+    const gchar *name;
+    gchar *finish_name;
+    GIBaseInfo *container;
+    GIBaseInfo *finish_info = NULL;
+    PyObject *py_finish_info;
+
+    name = g_base_info_get_name((GIBaseInfo *)info);
+    if (!g_str_has_suffix(name, "_async")) {
+        PyErr_Format(PyExc_TypeError, "%s.%s is not an asynchronous function",
+                g_base_info_get_namespace((GIBaseInfo *)info), name);
+        return NULL;
+    }
+
+    finish_name = g_strdup_printf("%.*s_finish", (int)(strlen(name) - strlen("_async")), name);
+
+    container = g_base_info_get_container((GIBaseInfo *)info);
+    if (container != NULL && g_base_info_get_type(container) == GI_INFO_TYPE_OBJECT) {
+        finish_info = (GIBaseInfo *)g_object_info_find_method((GIObjectInfo *)container, finish_name);
+    } else if (container != NULL && g_base_info_get_type(container) == GI_INFO_TYPE_INTERFACE) {
+        finish_info = (GIBaseInfo *)g_interface_info_find_method((GIInterfaceInfo *)container, finish_name);
+    } else {
+        finish_info = g_irepository_find_by_name(NULL,
+                g_base_info_get_namespace((GIBaseInfo *)info), finish_name);
+        if (finish_info != NULL && g_base_info_get_type(finish_info) != GI_INFO_TYPE_FUNCTION) {
+            g_base_info_unref(finish_info);
+            finish_info = NULL;
+        }
+    }
+
+    if (finish_info == NULL) {
+        PyErr_Format(PyExc_TypeError, "%s.%s has no %s counterpart",
+                g_base_info_get_namespace((GIBaseInfo *)info), name, finish_name);
+        g_free(finish_name);
+        return NULL;
+    }
+
+    g_free(finish_name);
+
+    py_finish_info = _pygi_info_new(finish_info);
+    g_base_info_unref(finish_info);
+
+    return py_finish_info;
+}
+
+/* Guards the completion of invocations on the worker pool. */
+static GMutex *worker_mutex = NULL;
+static GCond *worker_cond = NULL;
+static GThreadPool *worker_pool = NULL;
+
+static PyGIFuture *
+_pygi_future_new (void)
+{
+    PyGIFuture *future;
+
+    future = PyObject_GC_New(PyGIFuture, &PyGIFuture_Type);
+    if (future == NULL) {
+        return NULL;
+    }
+
+    future->py_finish_info = NULL;
+    future->done = FALSE;
+    future->result = NULL;
+    future->exc_type = NULL;
+    future->exc_value = NULL;
+    future->exc_traceback = NULL;
+    future->callbacks = NULL;
+    future->context = NULL;
+    future->py_info = NULL;
+    future->py_args = NULL;
+    future->invoke_state = NULL;
+    future->invoke_storage = NULL;
+    future->call_done = FALSE;
+    future->has_callbacks = FALSE;
+    future->collecting = NULL;
+
+    PyObject_GC_Track((PyObject *)future);
+
+    return future;
+}
+
+static PyObject *
+_pygi_future_call_callback (PyGIFuture *self,
+                            PyObject   *callback)
+{
+    return PyObject_CallFunctionObjArgs(callback, (PyObject *)self, NULL);
+}
+
+/* Store the result, or the pending exception if there is none, and run the
+ * callbacks. */
+static void
+_pygi_future_complete (PyGIFuture *self)
+{
+    if (self->result == NULL) {
+        PyErr_Fetch(&self->exc_type, &self->exc_value, &self->exc_traceback);
+        PyErr_NormalizeException(&self->exc_type, &self->exc_value, &self->exc_traceback);
+    }
+
+    self->done = TRUE;
+
+    if (self->callbacks != NULL) {
+        Py_ssize_t i;
+
+        for (i = 0; i < PyList_GET_SIZE(self->callbacks); i++) {
+            PyObject *retval;
+
+            retval = _pygi_future_call_callback(self, PyList_GET_ITEM(self->callbacks, i));
+            if (retval == NULL) {
+                PyErr_Print();
+            }
+            Py_XDECREF(retval);
+        }
+        Py_CLEAR(self->callbacks);
+    }
+}
+
+/* Convert the outcome of a native call which is over.  The GIL must be
+ * held.  Both the worker and the caller may get here, and converting can
+ * release the GIL, so the first one takes the state for itself. */
+static void
+_pygi_future_collect (PyGIFuture *self)
+{
+    PyGIInvokeState *state;
+    gpointer storage;
+
+    if (self->done || self->collecting != NULL) {
+        return;
+    }
+
+    state = self->invoke_state;
+    storage = self->invoke_storage;
+    self->invoke_state = NULL;
+    self->invoke_storage = NULL;
+    self->collecting = PyThreadState_GET();
+
+    self->result = _pygi_invoke_process(state, self->py_args);
+
+    g_free(storage);
+    g_slice_free(PyGIInvokeState, state);
+
+    _pygi_future_complete(self);
+
+    self->collecting = NULL;
+}
+
+static void
+_pygi_future_worker (gpointer data,
+                     gpointer user_data)
+{
+    PyGIFuture *self = data;
+    gboolean has_callbacks;
+
+    _pygi_invoke_call(self->invoke_state);
+
+    g_mutex_lock(worker_mutex);
+    self->call_done = TRUE;
+    has_callbacks = self->has_callbacks;
+    g_cond_broadcast(worker_cond);
+    g_mutex_unlock(worker_mutex);
+
+    /* Callbacks are run right away, and hold a reference until then. */
+    if (has_callbacks) {
+        PyGILState_STATE state;
+
+        state = PyGILState_Ensure();
+        _pygi_future_collect(self);
+        Py_DECREF((PyObject *)self);
+        PyGILState_Release(state);
+    }
+}
+
+PyObject *
+_wrap_g_function_info_invoke_async (PyGIBaseInfo *self,
+                                    PyObject     *py_args)
+{
+    PyGIInvokePlan *plan;
+    PyGIFuture *future;
+
+    plan = _pygi_invoke_plan_get(self);
+    if (plan == NULL) {
+        return NULL;
+    }
+
+    if (worker_pool == NULL) {
+        GError *error = NULL;
+        gint max_threads = 4;
+
+#ifdef _SC_NPROCESSORS_ONLN
+        max_threads = MAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+#endif
+
+        if (!g_thread_supported())
+            g_thread_init(NULL);
+        PyEval_InitThreads();
+
+        worker_mutex = g_mutex_new();
+        worker_cond = g_cond_new();
+        worker_pool = g_thread_pool_new(_pygi_future_worker, NULL, max_threads, FALSE, &error);
+        if (worker_pool == NULL) {
+            PyErr_SetString(PyExc_RuntimeError, error->message);
+            g_error_free(error);
+            return NULL;
+        }
+    }
+
+    future = _pygi_future_new();
+    if (future == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF((PyObject *)self);
+    future->py_info = (PyObject *)self;
+    Py_INCREF(py_args);
+    future->py_args = py_args;
+
+    future->invoke_state = g_slice_new(PyGIInvokeState);
+    future->invoke_storage = g_malloc(plan->state_size);
+    _pygi_invoke_state_init(future->invoke_state, plan, future->invoke_storage);
+
+    if (!_pygi_invoke_prepare(self, future->invoke_state, py_args)) {
+        g_free(future->invoke_storage);
+        g_slice_free(PyGIInvokeState, future->invoke_state);
+        future->invoke_storage = NULL;
+        future->invoke_state = NULL;
+        Py_DECREF((PyObject *)future);
+        return NULL;
+    }
+
+    g_thread_pool_push(worker_pool, future, NULL);
+
+    return (PyObject *)future;
+}
+
+/* Called natively as the GAsyncReadyCallback of the operation, which holds
+ * a reference to the future. */
+static void
+_pygi_future_ready (GObject  *source_object,
+                    gpointer  result,
+                    gpointer  user_data)
+{
+    PyGILState_STATE state;
+    PyGIFuture *self = user_data;
+    PyGIInvokePlan *finish_plan;
+    PyObject *py_args;
+    PyObject *py_result;
+
+    state = PyGILState_Ensure();
+
+    finish_plan = _pygi_invoke_plan_get((PyGIBaseInfo *)self->py_finish_info);
+    g_assert(finish_plan != NULL);
+
+    py_result = pygobject_new((GObject *)result);
+    if (py_result == NULL) {
+        py_args = NULL;
+    } else if (finish_plan->is_method) {
+        PyObject *py_source;
+
+        py_source = pygobject_new(source_object);
+        py_args = py_source != NULL ? PyTuple_Pack(2, py_source, py_result) : NULL;
+        Py_XDECREF(py_source);
+    } else {
+        py_args = PyTuple_Pack(1, py_result);
+    }
+    Py_XDECREF(py_result);
+
+    if (py_args != NULL) {
+        self->result = _wrap_g_function_info_invoke((PyGIBaseInfo *)self->py_finish_info, py_args);
+        Py_DECREF(py_args);
+    }
+
+    _pygi_future_complete(self);
+
+    Py_DECREF((PyObject *)self);
+
+    PyGILState_Release(state);
+}
+
+PyObject *
+_wrap_g_function_info_invoke_future (PyGIBaseInfo *self,
+                                     PyObject     *py_args)
+{
+    PyGIInvokePlan *plan;
+    PyGIFuture *future;
+    PyObject *py_full_args;
+    PyObject *retval;
+    Py_ssize_t n_py_args, callback_pos, user_data_pos, i, j;
+
+    plan = _pygi_invoke_plan_get(self);
+    if (plan == NULL) {
+        return NULL;
+    }
+
+    if (plan->callback_py_pos < 0 || plan->user_data_py_pos < 0) {
+        PyErr_Format(PyExc_TypeError, "%s.%s takes no callback with user data",
+                g_base_info_get_namespace(self->info), g_base_info_get_name(self->info));
+        return NULL;
+    }
+
+    if (plan->py_finish_info == NULL) {
+        plan->py_finish_info = _pygi_future_find_finish_info((GIFunctionInfo *)self->info);
+        if (plan->py_finish_info == NULL) {
+            return NULL;
+        }
+        if (_pygi_invoke_plan_get((PyGIBaseInfo *)plan->py_finish_info) == NULL) {
+            Py_CLEAR(plan->py_finish_info);
+            return NULL;
+        }
+    }
+
+    /* The callback and user data are given natively. */
+    n_py_args = PyTuple_GET_SIZE(py_args);
+    if (n_py_args + 2 != plan->n_py_args) {
+        PyErr_Format(PyExc_TypeError,
+            "takes exactly %zd argument(s) (%zd given)",
+            plan->n_py_args - 2, n_py_args);
+        return NULL;
+    }
+
+    future = _pygi_future_new();
+    if (future == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(plan->py_finish_info);
+    future->py_finish_info = plan->py_finish_info;
+
+    /* GIO completes operations in the thread-default main context of the
+     * thread starting them. */
+    future->context = g_main_context_get_thread_default();
+    if (future->context != NULL) {
+        g_main_context_ref(future->context);
+    }
+
+    py_full_args = PyTuple_New(plan->n_py_args);
+    if (py_full_args == NULL) {
+        Py_DECREF((PyObject *)future);
+        return NULL;
+    }
+
+    callback_pos = plan->callback_py_pos;
+    user_data_pos = plan->user_data_py_pos;
+
+    for (i = 0, j = 0; i < plan->n_py_args; i++) {
+        PyObject *py_arg;
+
+        if (i == callback_pos) {
+            py_arg = _pygi_native_callback_new(_pygi_future_ready);
+        } else if (i == user_data_pos) {
+            py_arg = PyCObject_FromVoidPtr(future, NULL);
+        } else {
+            py_arg = PyTuple_GET_ITEM(py_args, j++);
+            Py_INCREF(py_arg);
+        }
+
+        if (py_arg == NULL) {
+            Py_DECREF(py_full_args);
+            Py_DECREF((PyObject *)future);
+            return NULL;
+        }
+
+        PyTuple_SET_ITEM(py_full_args, i, py_arg);
+    }
+
+    /* Held by the operation until it completes. */
+    Py_INCREF((PyObject *)future);
+
+    retval = _wrap_g_function_info_invoke(self, py_full_args);
+
+    Py_DECREF(py_full_args);
+
+    if (retval == NULL) {
+        Py_DECREF((PyObject *)future);
+        Py_DECREF((PyObject *)future);
+        return NULL;
+    }
+
+    Py_DECREF(retval);
+
+    return (PyObject *)future;
+}
+
+/* Wait for the native call on the worker pool to be over. */
+static void
+_pygi_future_wait_call (PyGIFuture *self)
+{
+    Py_BEGIN_ALLOW_THREADS
+    g_mutex_lock(worker_mutex);
+    while (!self->call_done) {
+        g_cond_wait(worker_cond, worker_mutex);
+    }
+    g_mutex_unlock(worker_mutex);
+    Py_END_ALLOW_THREADS
+}
+
+/* Run the main context of the operation until it completes, or wait for
+ * the invocation.  When another thread runs that context, or collects the
+ * invocation, it completes the operation, so only wait for it. */
+static gboolean
+_pygi_future_wait (PyGIFuture *self)
+{
+    GMainContext *context;
+
+    if (self->invoke_state != NULL || self->collecting != NULL) {
+        if (self->invoke_state != NULL) {
+            _pygi_future_wait_call(self);
+            _pygi_future_collect(self);
+        }
+
+        if (!self->done && self->collecting == PyThreadState_GET()) {
+            PyErr_SetString(PyExc_RuntimeError, "the future is being completed by this thread");
+            return FALSE;
+        }
+
+        while (!self->done) {
+            Py_BEGIN_ALLOW_THREADS
+            g_usleep(1000);
+            Py_END_ALLOW_THREADS
+        }
+
+        return TRUE;
+    }
+
+    context = self->context != NULL ? self->context : g_main_context_default();
+
+    while (!self->done) {
+        Py_BEGIN_ALLOW_THREADS
+        if (g_main_context_acquire(context)) {
+            g_main_context_iteration(context, TRUE);
+            g_main_context_release(context);
+        } else {
+            g_usleep(1000);
+        }
+        Py_END_ALLOW_THREADS
+    }
+
+    return TRUE;
+}
+
+static int
+_future_traverse (PyGIFuture *self,
+                  visitproc   visit,
+                  void       *arg)
+{
+    Py_VISIT(self->py_finish_info);
+    Py_VISIT(self->result);
+    Py_VISIT(self->exc_type);
+    Py_VISIT(self->exc_value);
+    Py_VISIT(self->exc_traceback);
+    Py_VISIT(self->callbacks);
+    Py_VISIT(self->py_info);
+    Py_VISIT(self->py_args);
+    return 0;
+}
+
+/* The arguments are needed until the invocation is collected. */
+static int
+_future_clear (PyGIFuture *self)
+{
+    Py_CLEAR(self->result);
+    Py_CLEAR(self->exc_type);
+    Py_CLEAR(self->exc_value);
+    Py_CLEAR(self->exc_traceback);
+    Py_CLEAR(self->callbacks);
+    if (self->invoke_state == NULL && self->collecting == NULL) {
+        Py_CLEAR(self->py_args);
+    }
+    return 0;
+}
+
+static void
+_future_dealloc (PyGIFuture *self)
+{
+    PyObject_GC_UnTrack((PyObject *)self);
+
+    /* The worker may still be using the state. */
+    if (self->invoke_state != NULL) {
+        _pygi_future_wait_call(self);
+        _pygi_future_collect(self);
+        if (PyErr_Occurred()) {
+            PyErr_Clear();
+        }
+    }
+
+    Py_CLEAR(self->py_info);
+    Py_CLEAR(self->py_args);
+    Py_CLEAR(self->py_finish_info);
+    Py_CLEAR(self->result);
+    Py_CLEAR(self->exc_type);
+    Py_CLEAR(self->exc_value);
+    Py_CLEAR(self->exc_traceback);
+    Py_CLEAR(self->callbacks);
+
+    if (self->context != NULL) {
+        g_main_context_unref(self->context);
+    }
+
+    PyObject_GC_Del((PyObject *)self);
+}
+
+static PyObject *
+_wrap_future_done (PyGIFuture *self)
+{
+    gboolean done = self->done;
+
+    if (!done && self->invoke_state != NULL) {
+        g_mutex_lock(worker_mutex);
+        done = self->call_done;
+        g_mutex_unlock(worker_mutex);
+    }
+
+    return PyBool_FromLong(done);
+}
+
+static PyObject *
+_wrap_future_result (PyGIFuture *self)
+{
+    if (!_pygi_future_wait(self)) {
+        return NULL;
+    }
+
+    if (self->exc_type != NULL) {
+        Py_INCREF(self->exc_type);
+        Py_XINCREF(self->exc_value);
+        Py_XINCREF(self->exc_traceback);
+        PyErr_Restore(self->exc_type, self->exc_value, self->exc_traceback);
+        return NULL;
+    }
+
+    Py_INCREF(self->result);
+    return self->result;
+}
+
+static PyObject *
+_wrap_future_exception (PyGIFuture *self)
+{
+    if (!_pygi_future_wait(self)) {
+        return NULL;
+    }
+
+    if (self->exc_value == NULL) {
+        Py_RETURN_NONE;
+    }
+
+    Py_INCREF(self->exc_value);
+    return self->exc_value;
+}
+
+static PyObject *
+_wrap_future_add_done_callback (PyGIFuture *self,
+                                PyObject   *callback)
+{
+    if (!PyCallable_Check(callback)) {
+        PyErr_Format(PyExc_TypeError, "must be callable, not %s",
+                callback->ob_type->tp_name);
+        return NULL;
+    }
+
+    if (self->done) {
+        PyObject *retval;
+
+        retval = _pygi_future_call_callback(self, callback);
+        if (retval == NULL) {
+            return NULL;
+        }
+        Py_DECREF(retval);
+
+        Py_RETURN_NONE;
+    }
+
+    if (self->callbacks == NULL) {
+        self->callbacks = PyList_New(0);
+        if (self->callbacks == NULL) {
+            return NULL;
+        }
+    }
+
+    if (PyList_Append(self->callbacks, callback) < 0) {
+        return NULL;
+    }
+
+    /* Have the worker run the callbacks, unless it is too late. */
+    if (self->invoke_state != NULL) {
+        gboolean call_done;
+
+        g_mutex_lock(worker_mutex);
+        call_done = self->call_done;
+        if (!call_done && !self->has_callbacks) {
+            self->has_callbacks = TRUE;
+            Py_INCREF((PyObject *)self);
+        }
+        g_mutex_unlock(worker_mutex);
+
+        if (call_done) {
+            _pygi_future_collect(self);
+        }
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef _PyGIFuture_methods[] = {
+    { "done", (PyCFunction)_wrap_future_done, METH_NOARGS },
+    { "result", (PyCFunction)_wrap_future_result, METH_NOARGS },
+    { "exception", (PyCFunction)_wrap_future_exception, METH_NOARGS },
+    { "add_done_callback", (PyCFunction)_wrap_future_add_done_callback, METH_O },
+    { NULL, NULL, 0 }
+};
+
+PyTypeObject PyGIFuture_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0,
+    "gi.Future",                               /* tp_name */
+    sizeof(PyGIFuture),                        /* tp_basicsize */
+    0,                                         /* tp_itemsize */
+    (destructor)_future_dealloc,               /* tp_dealloc */
+    (printfunc)NULL,                           /* tp_print */
+    (getattrfunc)NULL,                         /* tp_getattr */
+    (setattrfunc)NULL,                         /* tp_setattr */
+    (cmpfunc)NULL,                             /* tp_compare */
+    (reprfunc)NULL,                            /* tp_repr */
+    NULL,                                      /* tp_as_number */
+    NULL,                                      /* tp_as_sequence */
+    NULL,                                      /* tp_as_mapping */
+    (hashfunc)NULL,                            /* tp_hash */
+    (ternaryfunc)NULL,                         /* tp_call */
+    (reprfunc)NULL,                            /* tp_str */
+    (getattrofunc)NULL,                        /* tp_getattro */
+    (setattrofunc)NULL,                        /* tp_setattro */
+    NULL,                                      /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,   /* tp_flags */
+    NULL,                                      /* tp_doc */
+    (traverseproc)_future_traverse,            /* tp_traverse */
+    (inquiry)_future_clear,                    /* tp_clear */
+};
+
+void
+_pygi_async_register_types (PyObject *m)
+{
+    if (_pygobject_import() < 0)
+        return;
+
+    PyGIFuture_Type.ob_type = &PyType_Type;
+    PyGIFuture_Type.tp_methods = _PyGIFuture_methods;
+    if (PyType_Ready(&PyGIFuture_Type))
+        return;
+    if (PyModule_AddObject(m, "Future", (PyObject *)&PyGIFuture_Type))
+        return;
+}
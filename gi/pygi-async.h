@@ -0,0 +1,69 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-async.h: futures for asynchronous functions.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_ASYNC_H__
+#define __PYGI_ASYNC_H__
+
+#include <Python.h>
+
+#include <girepository.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *py_finish_info;
+    gboolean done;
+    PyObject *result;
+    PyObject *exc_type;
+    PyObject *exc_value;
+    PyObject *exc_traceback;
+    PyObject *callbacks;
+
+    /* Where the operation completes, NULL for the default main context. */
+    GMainContext *context;
+
+    /* For invocations on the worker pool. */
+    PyObject *py_info;
+    PyObject *py_args;
+    PyGIInvokeState *invoke_state;
+    gpointer invoke_storage;
+    gboolean call_done;
+    gboolean has_callbacks;
+    /* Thread converting the outcome of the invocation, if any. */
+    PyThreadState *collecting;
+} PyGIFuture;
+
+
+/* Private */
+
+extern PyTypeObject PyGIFuture_Type;
+
+PyObject *_wrap_g_function_info_invoke_future (PyGIBaseInfo *self,
+                                               PyObject     *py_args);
+PyObject *_wrap_g_function_info_invoke_async (PyGIBaseInfo *self,
+                                              PyObject     *py_args);
+
+void _pygi_async_register_types (PyObject *m);
+
+G_END_DECLS
+
+#endif /* __PYGI_ASYNC_H__ */
@@ -35,6 +35,11 @@ _boxed_dealloc (PyGIBoxed *self)
 
     PyObject_ClearWeakRefs((PyObject *)self);
 
+    _pygi_struct_set_parent((PyObject *)self, NULL);
+
+    PYGI_PROBE3(boxed__free, ((PyObject *)self)->ob_type->tp_name,
+            ((PyGBoxed *)self)->boxed, ((PyGBoxed *)self)->free_on_dealloc);
+
     if (((PyGBoxed *)self)->free_on_dealloc) {
         if (self->slice_allocated) {
             g_slice_free1(self->size, ((PyGBoxed *)self)->boxed);
@@ -47,22 +52,34 @@ _boxed_dealloc (PyGIBoxed *self)
     ((PyGObject *)self)->ob_type->tp_free((PyObject *)self);
 }
 
+static int
+_boxed_traverse (PyGIBoxed *self,
+                 visitproc visit,
+                 void     *arg)
+{
+    Py_VISIT(self->parent);
+    return 0;
+}
+
+static int
+_boxed_clear (PyGIBoxed *self)
+{
+    _pygi_struct_set_parent((PyObject *)self, NULL);
+    return 0;
+}
+
 static PyObject *
 _boxed_new (PyTypeObject *type,
             PyObject     *args,
             PyObject     *kwargs)
 {
-    static char *kwlist[] = { NULL };
-
     GIBaseInfo *info;
+    PyGIStructLayout *layout;
+    gboolean has_values;
     gsize size;
     gpointer boxed;
     PyGIBoxed *self = NULL;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "", kwlist)) {
-        return NULL;
-    }
-
     info = _pygi_object_get_gi_info((PyObject *)type, &PyGIStructInfo_Type);
     if (info == NULL) {
         if (PyErr_ExceptionMatches(PyExc_AttributeError)) {
@@ -71,13 +88,19 @@ _boxed_new (PyTypeObject *type,
         return NULL;
     }
 
-    size = g_struct_info_get_size((GIStructInfo *)info);
-    boxed = g_slice_alloc0(size);
-    if (boxed == NULL) {
-        PyErr_NoMemory();
+    layout = _pygi_struct_layout_get((GIStructInfo *)info);
+
+    /* Simple structs can be initialized from their field values. */
+    has_values = PyTuple_GET_SIZE(args) > 0 || (kwargs != NULL && PyDict_Size(kwargs) > 0);
+    if (has_values && !layout->is_simple) {
+        PyErr_Format(PyExc_TypeError, "%s() takes no arguments, as it is not a simple structure",
+                type->tp_name);
         goto out;
     }
 
+    size = layout->size;
+    boxed = g_slice_alloc0(size);
+
     self = (PyGIBoxed *)_pygi_boxed_new(type, boxed, TRUE);
     if (self == NULL) {
         g_slice_free1(size, boxed);
@@ -87,6 +110,10 @@ _boxed_new (PyTypeObject *type,
     self->size = size;
     self->slice_allocated = TRUE;
 
+    if (has_values && _pygi_fields_update((PyObject *)self, args, kwargs) < 0) {
+        Py_CLEAR(self);
+    }
+
 out:
     g_base_info_unref(info);
 
@@ -123,11 +150,12 @@ PyTypeObject PyGIBoxed_Type = {
     (reprfunc)NULL,                            /* tp_str */
     (getattrofunc)NULL,                        /* tp_getattro */
     (setattrofunc)NULL,                        /* tp_setattro */
-    NULL,                                      /* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,  /* tp_flags */
+    &_pygi_struct_as_buffer,                   /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE |
+        Py_TPFLAGS_HAVE_NEWBUFFER | Py_TPFLAGS_HAVE_GC, /* tp_flags */
     NULL,                                      /* tp_doc */
-    (traverseproc)NULL,                        /* tp_traverse */
-    (inquiry)NULL,                             /* tp_clear */
+    (traverseproc)_boxed_traverse,             /* tp_traverse */
+    (inquiry)_boxed_clear,                     /* tp_clear */
     (richcmpfunc)NULL,                         /* tp_richcompare */
     0,                                         /* tp_weaklistoffset */
     (getiterfunc)NULL,                         /* tp_iter */
@@ -164,6 +192,10 @@ _pygi_boxed_new (PyTypeObject *type,
     ((PyGBoxed *)self)->free_on_dealloc = free_on_dealloc;
     self->size = 0;
     self->slice_allocated = FALSE;
+    self->parent = NULL;
+    self->n_views = 0;
+
+    PYGI_PROBE3(boxed__new, type->tp_name, boxed, free_on_dealloc);
 
     return (PyObject *)self;
 }
@@ -175,6 +207,8 @@ _pygi_boxed_register_types (PyObject *m)
     PyGIBoxed_Type.tp_base = &PyGBoxed_Type;
     PyGIBoxed_Type.tp_new = (newfunc)_boxed_new;
     PyGIBoxed_Type.tp_init = (initproc)_boxed_init;
+    /* PyGBoxed is not collectable. */
+    PyGIBoxed_Type.tp_free = PyObject_GC_Del;
     if (PyType_Ready(&PyGIBoxed_Type))
         return;
     if (PyModule_AddObject(m, "Boxed", (PyObject *)&PyGIBoxed_Type))
@@ -0,0 +1,403 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-buffer.c: buffer export for simple structures.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+#include <pygobject.h>
+
+#include <string.h>
+
+#define _PYGI_FORMAT_FOR_SIZE(size) ((size) == 8 ? "q" : (size) == 4 ? "i" : (size) == 2 ? "h" : "b")
+#define _PYGI_UFORMAT_FOR_SIZE(size) ((size) == 8 ? "Q" : (size) == 4 ? "I" : (size) == 2 ? "H" : "B")
+
+static const gchar *
+_pygi_buffer_get_tag_format (GITypeTag type_tag)
+{
+    switch (type_tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+            return _PYGI_FORMAT_FOR_SIZE(sizeof(gboolean));
+        case GI_TYPE_TAG_INT8:
+            return "b";
+        case GI_TYPE_TAG_UINT8:
+            return "B";
+        case GI_TYPE_TAG_INT16:
+            return "h";
+        case GI_TYPE_TAG_UINT16:
+            return "H";
+        case GI_TYPE_TAG_INT32:
+            return "i";
+        case GI_TYPE_TAG_UINT32:
+            return "I";
+        case GI_TYPE_TAG_INT64:
+            return "q";
+        case GI_TYPE_TAG_UINT64:
+            return "Q";
+        case GI_TYPE_TAG_SHORT:
+            return _PYGI_FORMAT_FOR_SIZE(sizeof(gshort));
+        case GI_TYPE_TAG_USHORT:
+            return _PYGI_UFORMAT_FOR_SIZE(sizeof(gushort));
+        case GI_TYPE_TAG_INT:
+            return _PYGI_FORMAT_FOR_SIZE(sizeof(gint));
+        case GI_TYPE_TAG_UINT:
+            return _PYGI_UFORMAT_FOR_SIZE(sizeof(guint));
+        case GI_TYPE_TAG_LONG:
+            return _PYGI_FORMAT_FOR_SIZE(sizeof(glong));
+        case GI_TYPE_TAG_ULONG:
+            return _PYGI_UFORMAT_FOR_SIZE(sizeof(gulong));
+        case GI_TYPE_TAG_SSIZE:
+            return _PYGI_FORMAT_FOR_SIZE(sizeof(gssize));
+        case GI_TYPE_TAG_SIZE:
+            return _PYGI_UFORMAT_FOR_SIZE(sizeof(gsize));
+        case GI_TYPE_TAG_FLOAT:
+            return "f";
+        case GI_TYPE_TAG_DOUBLE:
+            return "d";
+        case GI_TYPE_TAG_TIME_T:
+            return _PYGI_FORMAT_FOR_SIZE(sizeof(time_t));
+        case GI_TYPE_TAG_GTYPE:
+            return _PYGI_UFORMAT_FOR_SIZE(sizeof(GType));
+        default:
+            return NULL;
+    }
+}
+
+/* Sizes are standard, and padding is explicit, so that the format describes
+ * the layout the typelib gives rather than the one the consumer would guess. */
+static void
+_pygi_buffer_append_struct_format (GString          *format,
+                                   PyGIStructLayout *layout)
+{
+    gsize offset;
+    gsize i;
+
+    g_string_append(format, "T{");
+
+    offset = 0;
+
+    for (i = 0; i < layout->n_fields; i++) {
+        PyGIFieldLayout *field_layout;
+
+        field_layout = &layout->fields[i];
+
+        if (field_layout->offset > offset) {
+            g_string_append_printf(format, "%" G_GSIZE_FORMAT "x", field_layout->offset - offset);
+        }
+
+        if (field_layout->struct_layout != NULL) {
+            _pygi_buffer_append_struct_format(format, field_layout->struct_layout);
+        } else {
+            g_string_append(format, _pygi_buffer_get_tag_format(field_layout->type_tag));
+        }
+
+        g_string_append_printf(format, ":%s:", field_layout->name);
+
+        offset = field_layout->offset + field_layout->size;
+    }
+
+    if (layout->size > offset) {
+        g_string_append_printf(format, "%" G_GSIZE_FORMAT "x", layout->size - offset);
+    }
+
+    g_string_append_c(format, '}');
+}
+
+const gchar *
+_pygi_struct_layout_get_format (PyGIStructLayout *layout)
+{
+    GString *format;
+
+    g_assert(layout->is_simple);
+
+    if (layout->format == NULL) {
+        format = g_string_new("=");
+        _pygi_buffer_append_struct_format(format, layout);
+        layout->format = g_string_free(format, FALSE);
+    }
+
+    return layout->format;
+}
+
+static int
+_struct_get_buffer (PyObject  *self,
+                    Py_buffer *view,
+                    int        flags)
+{
+    GIBaseInfo *info;
+    PyGIStructLayout *layout;
+    gpointer pointer;
+
+    info = _pygi_object_get_gi_info((PyObject *)self->ob_type, &PyGIStructInfo_Type);
+    if (info == NULL) {
+        return -1;
+    }
+
+    layout = _pygi_struct_layout_get((GIStructInfo *)info);
+
+    g_base_info_unref(info);
+
+    if (!layout->is_simple) {
+        PyErr_Format(PyExc_BufferError, "'%s' is not a simple structure",
+                self->ob_type->tp_name);
+        return -1;
+    }
+
+    pointer = pyg_boxed_get(self, void);
+    if (pointer == NULL) {
+        PyErr_SetString(PyExc_ValueError, "instance has no underlying structure");
+        return -1;
+    }
+
+    view->buf = pointer;
+    view->obj = self;
+    Py_INCREF(self);
+    view->len = layout->size;
+    view->readonly = 0;
+    view->itemsize = view->len;
+    view->format = NULL;
+    if ((flags & PyBUF_FORMAT) == PyBUF_FORMAT) {
+        view->format = (char *)_pygi_struct_layout_get_format(layout);
+    }
+    view->ndim = 0;
+    view->shape = NULL;
+    view->strides = NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+
+    _pygi_struct_add_view(self, 1);
+
+    return 0;
+}
+
+static void
+_struct_release_buffer (PyObject  *self,
+                        Py_buffer *view)
+{
+    _pygi_struct_add_view(self, -1);
+}
+
+PyBufferProcs _pygi_struct_as_buffer = {
+    (readbufferproc)NULL,
+    (writebufferproc)NULL,
+    (segcountproc)NULL,
+    (charbufferproc)NULL,
+    (getbufferproc)_struct_get_buffer,
+    (releasebufferproc)_struct_release_buffer,
+};
+
+
+static void
+_struct_array_dealloc (PyGIStructArray *self)
+{
+    g_free(self->data);
+
+    Py_XDECREF((PyObject *)self->item_type);
+
+    self->ob_type->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t
+_struct_array_length (PyGIStructArray *self)
+{
+    return self->length;
+}
+
+static PyObject *
+_struct_array_item (PyGIStructArray *self,
+                    Py_ssize_t       index)
+{
+    gconstpointer item;
+    PyObject *py_item;
+
+    if (index < 0 || index >= self->length) {
+        PyErr_SetString(PyExc_IndexError, "index out of range");
+        return NULL;
+    }
+
+    item = (guint8 *)self->data + index * self->item_size;
+
+    /* Items are copied, so that they can outlive the array. */
+    if (PyType_IsSubtype(self->item_type, &PyGIBoxed_Type)) {
+        gpointer boxed;
+
+        boxed = g_slice_copy(self->item_size, item);
+
+        py_item = _pygi_boxed_new(self->item_type, boxed, TRUE);
+        if (py_item == NULL) {
+            g_slice_free1(self->item_size, boxed);
+            return NULL;
+        }
+
+        ((PyGIBoxed *)py_item)->size = self->item_size;
+        ((PyGIBoxed *)py_item)->slice_allocated = TRUE;
+    } else {
+        gpointer pointer;
+
+        pointer = g_try_malloc(self->item_size);
+        if (pointer == NULL) {
+            return PyErr_NoMemory();
+        }
+        memcpy(pointer, item, self->item_size);
+
+        py_item = _pygi_struct_new(self->item_type, pointer, TRUE);
+        if (py_item == NULL) {
+            g_free(pointer);
+            return NULL;
+        }
+    }
+
+    return py_item;
+}
+
+static int
+_struct_array_get_buffer (PyGIStructArray *self,
+                          Py_buffer       *view,
+                          int              flags)
+{
+    view->buf = self->data;
+    view->obj = (PyObject *)self;
+    Py_INCREF((PyObject *)self);
+    view->len = self->length * self->item_size;
+    view->readonly = 0;
+    view->itemsize = self->item_size;
+    view->format = NULL;
+    if ((flags & PyBUF_FORMAT) == PyBUF_FORMAT) {
+        view->format = (char *)_pygi_struct_layout_get_format(self->layout);
+    }
+    view->ndim = 1;
+    view->shape = NULL;
+    if ((flags & PyBUF_ND) == PyBUF_ND) {
+        view->shape = &self->length;
+    }
+    view->strides = NULL;
+    if ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) {
+        view->strides = &self->item_size;
+    }
+    view->suboffsets = NULL;
+    view->internal = NULL;
+
+    return 0;
+}
+
+static PySequenceMethods _struct_array_as_sequence = {
+    (lenfunc)_struct_array_length,             /* sq_length */
+    (binaryfunc)NULL,                          /* sq_concat */
+    (ssizeargfunc)NULL,                        /* sq_repeat */
+    (ssizeargfunc)_struct_array_item,          /* sq_item */
+};
+
+static PyBufferProcs _struct_array_as_buffer = {
+    (readbufferproc)NULL,
+    (writebufferproc)NULL,
+    (segcountproc)NULL,
+    (charbufferproc)NULL,
+    (getbufferproc)_struct_array_get_buffer,
+    (releasebufferproc)NULL,
+};
+
+/* Returning a StructArray rather than a tuple changes the type seen by every
+ * caller, so applications opt in with gi.set_struct_arrays_enabled(). */
+gboolean _pygi_struct_arrays_enabled = FALSE;
+
+PyTypeObject PyGIStructArray_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0,
+    "gi.StructArray",                          /* tp_name */
+    sizeof(PyGIStructArray),                   /* tp_basicsize */
+    0,                                         /* tp_itemsize */
+    (destructor)_struct_array_dealloc,         /* tp_dealloc */
+    (printfunc)NULL,                           /* tp_print */
+    (getattrfunc)NULL,                         /* tp_getattr */
+    (setattrfunc)NULL,                         /* tp_setattr */
+    (cmpfunc)NULL,                             /* tp_compare */
+    (reprfunc)NULL,                            /* tp_repr */
+    NULL,                                      /* tp_as_number */
+    &_struct_array_as_sequence,                /* tp_as_sequence */
+    NULL,                                      /* tp_as_mapping */
+    (hashfunc)NULL,                            /* tp_hash */
+    (ternaryfunc)NULL,                         /* tp_call */
+    (reprfunc)NULL,                            /* tp_str */
+    (getattrofunc)NULL,                        /* tp_getattro */
+    (setattrofunc)NULL,                        /* tp_setattro */
+    &_struct_array_as_buffer,                  /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /* tp_flags */
+};
+
+PyObject *
+_pygi_struct_array_from_g_array (GArray     *array,
+                                 GITypeInfo *item_type_info)
+{
+    GIBaseInfo *info;
+    PyObject *py_type = NULL;
+    PyGIStructArray *self = NULL;
+
+    /* Only arrays of simple structures with a wrapper class are handled;
+     * NULL is returned without an exception for others. */
+    if (g_type_info_get_tag(item_type_info) != GI_TYPE_TAG_INTERFACE
+            || g_type_info_is_pointer(item_type_info)) {
+        return NULL;
+    }
+
+    info = g_type_info_get_interface(item_type_info);
+
+    if (g_base_info_get_type(info) != GI_INFO_TYPE_STRUCT
+            || g_struct_info_is_foreign((GIStructInfo *)info)
+            || !pygi_g_struct_info_is_simple((GIStructInfo *)info)) {
+        goto out;
+    }
+
+    py_type = _pygi_type_import_by_gi_info(info);
+    if (py_type == NULL) {
+        goto out;
+    }
+
+    if (!PyType_IsSubtype((PyTypeObject *)py_type, &PyGIStruct_Type)
+            && !PyType_IsSubtype((PyTypeObject *)py_type, &PyGIBoxed_Type)) {
+        goto out;
+    }
+
+    self = PyObject_New(PyGIStructArray, &PyGIStructArray_Type);
+    if (self == NULL) {
+        goto out;
+    }
+
+    self->item_type = (PyTypeObject *)py_type;
+    py_type = NULL;
+    self->layout = _pygi_struct_layout_get((GIStructInfo *)info);
+    self->item_size = g_array_get_element_size(array);
+    self->length = array->len;
+    self->data = g_memdup(array->data, self->item_size * self->length);
+
+out:
+    Py_XDECREF(py_type);
+    g_base_info_unref(info);
+
+    return (PyObject *)self;
+}
+
+void
+_pygi_buffer_register_types (PyObject *m)
+{
+    PyGIStructArray_Type.ob_type = &PyType_Type;
+    if (PyType_Ready(&PyGIStructArray_Type))
+        return;
+    if (PyModule_AddObject(m, "StructArray", (PyObject *)&PyGIStructArray_Type))
+        return;
+}
@@ -0,0 +1,60 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-buffer.h: buffer export for simple structures.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_BUFFER_H__
+#define __PYGI_BUFFER_H__
+
+#include <Python.h>
+
+#include <girepository.h>
+
+#include "pygi-layout.h"
+
+G_BEGIN_DECLS
+
+typedef struct {
+    PyObject_HEAD
+    PyTypeObject *item_type;
+    PyGIStructLayout *layout;
+    Py_ssize_t item_size;
+    Py_ssize_t length;
+    gpointer data;
+} PyGIStructArray;
+
+
+/* Private */
+
+extern PyTypeObject PyGIStructArray_Type;
+
+extern gboolean _pygi_struct_arrays_enabled;
+
+extern PyBufferProcs _pygi_struct_as_buffer;
+
+const gchar *_pygi_struct_layout_get_format (PyGIStructLayout *layout);
+
+PyObject *_pygi_struct_array_from_g_array (GArray     *array,
+                                           GITypeInfo *item_type_info);
+
+void _pygi_buffer_register_types (PyObject *m);
+
+G_END_DECLS
+
+#endif /* __PYGI_BUFFER_H__ */
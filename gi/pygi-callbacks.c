@@ -141,16 +141,437 @@ _pygi_scan_for_callbacks (PyGIBaseInfo  *function_info,
     return TRUE;
 }
 
+static gboolean
+_pygi_type_info_matches (GITypeInfo *type_info,
+                         GITypeInfo *other_type_info)
+{
+    GITypeTag type_tag;
+    GIBaseInfo *info, *other_info;
+    gboolean matches;
+
+    type_tag = g_type_info_get_tag(type_info);
+    if (type_tag != g_type_info_get_tag(other_type_info)
+            || g_type_info_is_pointer(type_info) != g_type_info_is_pointer(other_type_info)) {
+        return FALSE;
+    }
+
+    if (type_tag != GI_TYPE_TAG_INTERFACE) {
+        return TRUE;
+    }
+
+    info = g_type_info_get_interface(type_info);
+    other_info = g_type_info_get_interface(other_type_info);
+
+    matches = strcmp(g_base_info_get_namespace(info), g_base_info_get_namespace(other_info)) == 0
+            && strcmp(g_base_info_get_name(info), g_base_info_get_name(other_info)) == 0;
+
+    g_base_info_unref(info);
+    g_base_info_unref(other_info);
+
+    return matches;
+}
+
+/* Whether a function can be called as a callback, as far as the number,
+ * directions, types and transfer of their arguments tell.  Callbacks list
+ * the GError argument which throwing functions take last. */
+static gboolean
+_pygi_callable_info_matches (GIFunctionInfo *function_info,
+                             GICallableInfo *callback_info)
+{
+    GICallableInfo *callable_info = (GICallableInfo *)function_info;
+    GITypeInfo *type_info, *other_type_info;
+    gboolean matches;
+    gint i, n_args;
+
+    n_args = g_callable_info_get_n_args(callable_info);
+
+    if (g_function_info_get_flags(function_info) & GI_FUNCTION_THROWS) {
+        GIArgInfo *arg_info;
+
+        if (n_args + 1 != g_callable_info_get_n_args(callback_info)) {
+            return FALSE;
+        }
+
+        arg_info = g_callable_info_get_arg(callback_info, n_args);
+        type_info = g_arg_info_get_type(arg_info);
+        matches = g_type_info_get_tag(type_info) == GI_TYPE_TAG_ERROR;
+        g_base_info_unref((GIBaseInfo *)type_info);
+        g_base_info_unref((GIBaseInfo *)arg_info);
+
+        if (!matches) {
+            return FALSE;
+        }
+    } else if (n_args != g_callable_info_get_n_args(callback_info)) {
+        return FALSE;
+    }
+
+    if (g_callable_info_get_caller_owns(callable_info)
+            != g_callable_info_get_caller_owns(callback_info)) {
+        return FALSE;
+    }
+
+    type_info = g_callable_info_get_return_type(callable_info);
+    other_type_info = g_callable_info_get_return_type(callback_info);
+    matches = _pygi_type_info_matches(type_info, other_type_info);
+    g_base_info_unref((GIBaseInfo *)type_info);
+    g_base_info_unref((GIBaseInfo *)other_type_info);
+
+    for (i = 0; i < n_args && matches; i++) {
+        GIArgInfo *arg_info, *other_arg_info;
+
+        arg_info = g_callable_info_get_arg(callable_info, i);
+        other_arg_info = g_callable_info_get_arg(callback_info, i);
+
+        type_info = g_arg_info_get_type(arg_info);
+        other_type_info = g_arg_info_get_type(other_arg_info);
+
+        matches = g_arg_info_get_direction(arg_info) == g_arg_info_get_direction(other_arg_info)
+                && g_arg_info_get_ownership_transfer(arg_info)
+                        == g_arg_info_get_ownership_transfer(other_arg_info)
+                && _pygi_type_info_matches(type_info, other_type_info);
+
+        g_base_info_unref((GIBaseInfo *)type_info);
+        g_base_info_unref((GIBaseInfo *)other_type_info);
+        g_base_info_unref((GIBaseInfo *)arg_info);
+        g_base_info_unref((GIBaseInfo *)other_arg_info);
+    }
+
+    return matches;
+}
+
+/* Marks the C objects holding native callbacks which pygi passes itself,
+ * like the completion callback of futures. */
+static const gchar _pygi_native_callback_desc[] = "gi.native_callback";
+
+PyObject *
+_pygi_native_callback_new (gpointer native)
+{
+    return PyCObject_FromVoidPtrAndDesc(native, (void *)_pygi_native_callback_desc, NULL);
+}
+
+gboolean
+_pygi_native_callback_check (PyObject *object)
+{
+    return PyCObject_Check(object)
+            && PyCObject_GetDesc(object) == (void *)_pygi_native_callback_desc;
+}
+
+/* The size and kind of the values of simple ctypes types, by type code:
+ * 0 for signed integers, 1 for unsigned integers, 2 for floating point. */
+static gboolean
+_pygi_ctypes_code_get_kind (gchar  code,
+                            gsize *size,
+                            gint  *kind)
+{
+    switch (code) {
+        case 'b': *size = 1; *kind = 0; break;
+        case 'B': *size = 1; *kind = 1; break;
+        case 'h': *size = sizeof(short); *kind = 0; break;
+        case 'H': *size = sizeof(short); *kind = 1; break;
+        case 'i': *size = sizeof(int); *kind = 0; break;
+        case 'I': *size = sizeof(int); *kind = 1; break;
+        case 'l': *size = sizeof(long); *kind = 0; break;
+        case 'L': *size = sizeof(long); *kind = 1; break;
+        case 'q': *size = sizeof(gint64); *kind = 0; break;
+        case 'Q': *size = sizeof(gint64); *kind = 1; break;
+        case 'f': *size = sizeof(gfloat); *kind = 2; break;
+        case 'd': *size = sizeof(gdouble); *kind = 2; break;
+        default:
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Whether a ctypes type passes values of a type the way C does.  Values
+ * passed by reference, and pointers, only need a pointer type. */
+static gboolean
+_pygi_ctypes_type_matches (GITypeInfo *type_info,
+                           gboolean    by_reference,
+                           PyObject   *ctype)
+{
+    GITypeTag type_tag;
+    PyObject *py_code;
+    gchar code;
+    gsize size, expected_size;
+    gint kind, expected_kind;
+
+    type_tag = g_type_info_get_tag(type_info);
+
+    if (ctype == Py_None) {
+        return !by_reference && type_tag == GI_TYPE_TAG_VOID
+                && !g_type_info_is_pointer(type_info);
+    }
+
+    /* Simple types have a type code; pointer types hold their target type
+     * instead. */
+    py_code = PyObject_GetAttrString(ctype, "_type_");
+    if (py_code == NULL) {
+        PyErr_Clear();
+        return FALSE;
+    }
+    code = PyString_Check(py_code) && PyString_GET_SIZE(py_code) == 1
+            ? PyString_AS_STRING(py_code)[0] : 'P';
+    Py_DECREF(py_code);
+
+    if (by_reference || g_type_info_is_pointer(type_info)) {
+        return code == 'P' || code == 'z' || code == 'Z';
+    }
+
+    expected_kind = type_tag == GI_TYPE_TAG_INT8 || type_tag == GI_TYPE_TAG_INT16
+            || type_tag == GI_TYPE_TAG_INT32 || type_tag == GI_TYPE_TAG_INT64
+            || type_tag == GI_TYPE_TAG_SHORT || type_tag == GI_TYPE_TAG_INT
+            || type_tag == GI_TYPE_TAG_LONG || type_tag == GI_TYPE_TAG_SSIZE
+            || type_tag == GI_TYPE_TAG_TIME_T || type_tag == GI_TYPE_TAG_BOOLEAN ? 0 : 1;
+
+    switch (type_tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+            expected_size = sizeof(gboolean);
+            break;
+        case GI_TYPE_TAG_INT8:
+        case GI_TYPE_TAG_UINT8:
+            expected_size = 1;
+            break;
+        case GI_TYPE_TAG_INT16:
+        case GI_TYPE_TAG_UINT16:
+            expected_size = 2;
+            break;
+        case GI_TYPE_TAG_INT32:
+        case GI_TYPE_TAG_UINT32:
+            expected_size = 4;
+            break;
+        case GI_TYPE_TAG_INT64:
+        case GI_TYPE_TAG_UINT64:
+            expected_size = 8;
+            break;
+        case GI_TYPE_TAG_SHORT:
+        case GI_TYPE_TAG_USHORT:
+            expected_size = sizeof(short);
+            break;
+        case GI_TYPE_TAG_INT:
+        case GI_TYPE_TAG_UINT:
+            expected_size = sizeof(int);
+            break;
+        case GI_TYPE_TAG_LONG:
+        case GI_TYPE_TAG_ULONG:
+            expected_size = sizeof(long);
+            break;
+        case GI_TYPE_TAG_SSIZE:
+        case GI_TYPE_TAG_SIZE:
+            expected_size = sizeof(gsize);
+            break;
+        case GI_TYPE_TAG_TIME_T:
+            expected_size = sizeof(time_t);
+            break;
+        case GI_TYPE_TAG_GTYPE:
+            expected_size = sizeof(GType);
+            break;
+        case GI_TYPE_TAG_FLOAT:
+            expected_size = sizeof(gfloat);
+            expected_kind = 2;
+            break;
+        case GI_TYPE_TAG_DOUBLE:
+            expected_size = sizeof(gdouble);
+            expected_kind = 2;
+            break;
+        case GI_TYPE_TAG_INTERFACE:
+        {
+            GIBaseInfo *info;
+            GIInfoType info_type;
+
+            info = g_type_info_get_interface(type_info);
+            info_type = g_base_info_get_type(info);
+            g_base_info_unref(info);
+
+            /* Structures passed by value can't be checked. */
+            if (info_type != GI_INFO_TYPE_ENUM && info_type != GI_INFO_TYPE_FLAGS) {
+                return FALSE;
+            }
+
+            /* Enumerations are passed as either signed or unsigned. */
+            return _pygi_ctypes_code_get_kind(code, &size, &kind)
+                    && kind != 2 && size == sizeof(gint);
+        }
+        default:
+            return FALSE;
+    }
+
+    return _pygi_ctypes_code_get_kind(code, &size, &kind)
+            && size == expected_size && kind == expected_kind;
+}
+
+/* Whether a ctypes function pointer has the prototype of a callback. */
+static gboolean
+_pygi_ctypes_function_matches (PyObject       *py_function,
+                               GICallableInfo *callback_info)
+{
+    PyObject *py_argtypes;
+    PyObject *py_restype;
+    GITypeInfo *type_info;
+    gboolean matches;
+    gint i, n_args;
+
+    py_argtypes = PyObject_GetAttrString(py_function, "argtypes");
+    py_restype = PyObject_GetAttrString(py_function, "restype");
+    if (py_argtypes == NULL || py_restype == NULL) {
+        PyErr_Clear();
+        Py_XDECREF(py_argtypes);
+        Py_XDECREF(py_restype);
+        return FALSE;
+    }
+
+    n_args = g_callable_info_get_n_args(callback_info);
+    matches = PyTuple_Check(py_argtypes) && PyTuple_GET_SIZE(py_argtypes) == n_args;
+
+    if (matches) {
+        type_info = g_callable_info_get_return_type(callback_info);
+        matches = _pygi_ctypes_type_matches(type_info, FALSE, py_restype);
+        g_base_info_unref((GIBaseInfo *)type_info);
+    }
+
+    for (i = 0; i < n_args && matches; i++) {
+        GIArgInfo *arg_info;
+
+        arg_info = g_callable_info_get_arg(callback_info, i);
+        type_info = g_arg_info_get_type(arg_info);
+
+        matches = _pygi_ctypes_type_matches(type_info,
+                g_arg_info_get_direction(arg_info) != GI_DIRECTION_IN,
+                PyTuple_GET_ITEM(py_argtypes, i));
+
+        g_base_info_unref((GIBaseInfo *)type_info);
+        g_base_info_unref((GIBaseInfo *)arg_info);
+    }
+
+    Py_DECREF(py_argtypes);
+    Py_DECREF(py_restype);
+
+    return matches;
+}
+
+/* Native functions are only passed as they are if their signature is
+ * known to match: introspected functions and ctypes function pointers are
+ * checked against the callback, and capsules must be named after it.
+ * Capsules and ctypes function pointers which don't match raise
+ * TypeError. */
+static gboolean
+_pygi_callback_get_native (PyObject       *py_function,
+                           GICallableInfo *callback_info,
+                           gpointer       *native)
+{
+    static PyObject *ctypes_func_ptr_type = NULL;
+    static PyObject *ctypes_addressof = NULL;
+    PyGIBaseInfo *py_info = NULL;
+
+    *native = NULL;
+
+    if (_pygi_native_callback_check(py_function)) {
+        *native = PyCObject_AsVoidPtr(py_function);
+        return *native != NULL;
+    }
+
+#if PY_VERSION_HEX >= 0x02070000
+    if (PyCapsule_CheckExact(py_function)) {
+        gchar *name;
+
+        name = _pygi_g_callable_info_get_qualified_name(callback_info);
+        if (!PyCapsule_IsValid(py_function, name)) {
+            PyErr_Format(PyExc_TypeError, "capsule for %s must be named '%s', not '%s'",
+                    name, name, PyCapsule_GetName(py_function));
+            g_free(name);
+            return FALSE;
+        }
+        *native = PyCapsule_GetPointer(py_function, name);
+        g_free(name);
+        return *native != NULL;
+    }
+#endif
+
+    /* Functions from modules wrap their info. */
+    if (PyFunction_Check(py_function) && ((PyFunctionObject *)py_function)->func_dict != NULL) {
+        py_info = (PyGIBaseInfo *)PyDict_GetItemString(
+                ((PyFunctionObject *)py_function)->func_dict, "__info__");
+    } else if (PyObject_TypeCheck(py_function, &PyGIFunctionInfo_Type)) {
+        py_info = (PyGIBaseInfo *)py_function;
+    }
+
+    if (py_info != NULL && PyObject_TypeCheck(py_info, &PyGIFunctionInfo_Type)) {
+        GIFunctionInfo *function_info = (GIFunctionInfo *)py_info->info;
+
+        if (g_function_info_get_flags(function_info)
+                & (GI_FUNCTION_IS_METHOD | GI_FUNCTION_IS_CONSTRUCTOR)) {
+            return FALSE;
+        }
+
+        if (!_pygi_callable_info_matches(function_info, callback_info)) {
+            return FALSE;
+        }
+
+        return g_typelib_symbol(g_base_info_get_typelib((GIBaseInfo *)function_info),
+                                g_function_info_get_symbol(function_info), native);
+    }
+
+    /* Only look for ctypes function pointers once ctypes is in use. */
+    if (ctypes_func_ptr_type == NULL) {
+        PyObject *ctypes;
+
+        ctypes = PyDict_GetItemString(PyImport_GetModuleDict(), "ctypes");
+        if (ctypes == NULL) {
+            return FALSE;
+        }
+
+        ctypes_func_ptr_type = PyObject_GetAttrString(ctypes, "_CFuncPtr");
+        ctypes_addressof = PyObject_GetAttrString(ctypes, "addressof");
+        if (ctypes_func_ptr_type == NULL || ctypes_addressof == NULL) {
+            Py_CLEAR(ctypes_func_ptr_type);
+            Py_CLEAR(ctypes_addressof);
+            PyErr_Clear();
+            return FALSE;
+        }
+    }
+
+    if (PyObject_IsInstance(py_function, ctypes_func_ptr_type) > 0) {
+        PyObject *py_address;
+        gpointer *address;
+
+        if (!_pygi_ctypes_function_matches(py_function, callback_info)) {
+            gchar *name;
+
+            name = _pygi_g_callable_info_get_qualified_name(callback_info);
+            PyErr_Format(PyExc_TypeError,
+                    "ctypes function doesn't match the prototype of %s", name);
+            g_free(name);
+            return FALSE;
+        }
+
+        /* The function pointer is the content of the ctypes object. */
+        py_address = PyObject_CallFunctionObjArgs(ctypes_addressof, py_function, NULL);
+        if (py_address == NULL) {
+            return FALSE;
+        }
+        address = PyLong_AsVoidPtr(py_address);
+        Py_DECREF(py_address);
+        if (address == NULL) {
+            return FALSE;
+        }
+
+        *native = *address;
+        return *native != NULL;
+    }
+
+    PyErr_Clear();
+
+    return FALSE;
+}
+
 gboolean
 _pygi_create_callback (PyGIBaseInfo  *function_info,
-                        gboolean       is_method,
-                        int            n_args,
-                        Py_ssize_t     py_argc,
                         PyObject      *py_argv,
                         guint8         callback_index,
-                        guint8         user_data_index,
-                        guint8         destroy_notify_index,
-                        PyGICClosure **closure_out)
+                        Py_ssize_t     callback_py_pos,
+                        Py_ssize_t     user_data_py_pos,
+                        PyGICClosure **closure_out,
+                        gpointer      *native_out)
 {
     GIArgInfo *callback_arg;
     GITypeInfo *callback_type;
@@ -158,7 +579,6 @@ _pygi_create_callback (PyGIBaseInfo  *function_info,
     GIScopeType scope;
     gboolean found_py_function;
     PyObject *py_function;
-    guint8 i, py_argv_pos;
     PyObject *py_user_data;
 
     callback_arg = g_callable_info_get_arg((GICallableInfo*) function_info->info, callback_index);
@@ -174,21 +594,27 @@ _pygi_create_callback (PyGIBaseInfo  *function_info,
     found_py_function = FALSE;
     py_function = Py_None;
     py_user_data = NULL;
-    
-    /* if its a method then we need to skip over 'self' */
-    if (is_method)
-        py_argv_pos = 1;
-    else
-        py_argv_pos = 0;
-
-    for (i = 0; i < n_args && i < py_argc; i++) {
-        if (i == callback_index) {
-            py_function = PyTuple_GetItem(py_argv, py_argv_pos);
-            found_py_function = TRUE;
-        } else if (i == user_data_index){
-            py_user_data = PyTuple_GetItem(py_argv, py_argv_pos);
-        }
-        py_argv_pos++;
+
+    if (callback_py_pos >= 0 && callback_py_pos < PyTuple_GET_SIZE(py_argv)) {
+        py_function = PyTuple_GET_ITEM(py_argv, callback_py_pos);
+        found_py_function = TRUE;
+    }
+    if (user_data_py_pos >= 0 && user_data_py_pos < PyTuple_GET_SIZE(py_argv)) {
+        py_user_data = PyTuple_GET_ITEM(py_argv, user_data_py_pos);
+    }
+
+    /* Native functions are passed as they are, without a closure. */
+    if (found_py_function
+            && _pygi_callback_get_native(py_function, (GICallableInfo *)callback_info, native_out)) {
+        g_base_info_unref((GIBaseInfo*) callback_info);
+        g_base_info_unref((GIBaseInfo*) callback_type);
+        return TRUE;
+    }
+
+    if (PyErr_Occurred()) {
+        g_base_info_unref((GIBaseInfo*) callback_info);
+        g_base_info_unref((GIBaseInfo*) callback_type);
+        return FALSE;
     }
 
     if (!found_py_function
@@ -212,5 +638,5 @@ _pygi_create_callback (PyGIBaseInfo  *function_info,
     g_base_info_unref((GIBaseInfo*) callback_info);
     g_base_info_unref((GIBaseInfo*) callback_type);
 
-    return TRUE;
+    return *closure_out != NULL;
 }
@@ -32,15 +32,16 @@ gboolean _pygi_scan_for_callbacks (PyGIBaseInfo  *self,
                                    guint8        *user_data_index,
                                    guint8        *destroy_notify_index);
 
+PyObject *_pygi_native_callback_new (gpointer native);
+gboolean _pygi_native_callback_check (PyObject *object);
+
 gboolean _pygi_create_callback (PyGIBaseInfo  *self,
-                                gboolean       is_method,
-                                int            n_args,
-                                Py_ssize_t     py_argc,
                                 PyObject      *py_argv,
                                 guint8         callback_index,
-                                guint8         user_data_index,
-                                guint8         destroy_notify_index,
-                                PyGICClosure **closure_out);
+                                Py_ssize_t     callback_py_pos,
+                                Py_ssize_t     user_data_py_pos,
+                                PyGICClosure **closure_out,
+                                gpointer      *native_out);
 
 G_END_DECLS
 
@@ -21,150 +21,557 @@
 
 #include "pygi-private.h"
 
-/* This maintains a list of closures which can be free'd whenever
-   as they have been called.  We will free them on the next
-   library function call.
+/* This maintains a stack of async closures which can be free'd as they
+   have been called.  Callbacks may run on any thread, so closures are
+   pushed without locking, and the whole stack is taken at once when it is
+   drained: from an idle handler on the default main context, when the
+   next callback is created, from gi.trim_free_lists(), or when it grows
+   over a threshold.  Without a running main loop only the latter three
+   reclaim closures.
+
+   Closures are pushed from their own handler, so a drain may see closures
+   whose handler has not returned yet; those are left in the stack until
+   it has.
  */
-static GSList* async_free_list;
+#define _PYGI_ASYNC_FREE_THRESHOLD 32
+#define _PYGI_ASYNC_FREE_RETRY_INTERVAL 10
+
+static PyGICClosure * volatile async_free_list;
+static volatile gint async_free_n_closures;
+static volatile gint async_free_idle_pending;
+
+static void
+_pygi_closure_async_free_push (PyGICClosure *closure)
+{
+    PyGICClosure *head;
+
+    do {
+        head = g_atomic_pointer_get(&async_free_list);
+        closure->next_free = head;
+    } while (!g_atomic_pointer_compare_and_exchange(&async_free_list, head, closure));
+
+    g_atomic_int_inc(&async_free_n_closures);
+}
+
+static void
+_pygi_closure_async_free_drain (void)
+{
+    PyGICClosure *closure;
+
+    do {
+        closure = g_atomic_pointer_get(&async_free_list);
+    } while (closure != NULL
+             && !g_atomic_pointer_compare_and_exchange(&async_free_list, closure, NULL));
+
+    while (closure != NULL) {
+        PyGICClosure *next = closure->next_free;
+
+        g_atomic_int_add(&async_free_n_closures, -1);
+        closure->next_free = NULL;
+        _pygi_invoke_closure_free(closure);
+
+        closure = next;
+    }
+}
+
+static gboolean
+_pygi_closure_async_free_idle (gpointer user_data)
+{
+    g_atomic_int_set(&async_free_idle_pending, FALSE);
+
+    _pygi_closure_async_free_drain();
+
+    return FALSE;
+}
+
+/* Closures which are still running are retried after an interval rather
+   than from another idle, so that a long handler on another thread does
+   not keep the main loop busy. */
+static void
+_pygi_closure_async_free_defer (PyGICClosure *closure,
+                                gboolean      retry)
+{
+    _pygi_closure_async_free_push(closure);
 
+    if (!g_atomic_int_compare_and_exchange(&async_free_idle_pending, FALSE, TRUE))
+        return;
+
+    if (retry)
+        g_timeout_add(_PYGI_ASYNC_FREE_RETRY_INTERVAL,
+                      _pygi_closure_async_free_idle, NULL);
+    else
+        g_idle_add(_pygi_closure_async_free_idle, NULL);
+}
+
+/* Closures which are not in use anymore are pooled per callback type, so
+ * that their ffi closure and marshalling plan can be reused.  Pools are
+ * keyed by the qualified name of the callback type, as the bare name is
+ * not unique across namespaces, and are only touched with the GIL held.
+ *
+ * Pooled closures don't keep their Python function: it could be a bound
+ * method keeping its instance alive, and rebinding it is all a closure
+ * popped for the same function would save. */
+#define _PYGI_CLOSURE_POOL_DEFAULT_CAPACITY 16
+
+static GHashTable *closure_pools;
+static gsize closure_pool_capacity = _PYGI_CLOSURE_POOL_DEFAULT_CAPACITY;
+
+/* The GIL must be held. */
 void
-_pygi_closure_handle (ffi_cif *cif,
-                      void    *result,
-                      void   **args,
-                      void    *data)
+_pygi_closure_invoke (PyGICClosure *closure,
+                      void        **args,
+                      void         *result)
 {
-    PyGILState_STATE state;
-    PyGICClosure *closure = data;
-    gint n_args, i;
-    GIArgInfo  *arg_info;
-    GIDirection arg_direction;
-    GITypeInfo *arg_type;
-    GITransfer arg_transfer;
-    GITypeTag  arg_tag;
-    GITypeTag  return_tag;
-    GITransfer return_transfer;
-    GITypeInfo *return_type;
-    PyObject *retval;
+    gsize i, n_in_args;
+    PyObject *retval = NULL;
     PyObject *py_args;
     PyObject *pyarg;
-    gint n_in_args, n_out_args;
+    guint64 times[_PYGI_STATS_N_PHASES];
+    guint64 start = 0;
+    PyThreadState *tstate;
+    PyObject *py_profile_function = NULL;
 
+    PYGI_PROBE2(closure__entry, closure->name, closure->n_py_args);
 
-    /* Lock the GIL as we are coming into this code without the lock and we
-      may be executing python code */
-    state = PyGILState_Ensure();
-
-    return_type = g_callable_info_get_return_type(closure->info);
-    return_tag = g_type_info_get_tag(return_type);
-    return_transfer = g_callable_info_get_caller_owns(closure->info);
+    if (G_UNLIKELY(_pygi_stats_enabled)) {
+        memset(times, 0, sizeof(times));
+        start = _pygi_stats_now();
+    }
 
-    n_args = g_callable_info_get_n_args (closure->info);  
+    /* The conversions are reported as a call to the callback type, around
+     * the call to the Python callable. */
+    tstate = PyThreadState_GET();
+    if (_pygi_profile_active(tstate)) {
+        py_profile_function = _pygi_profile_call(tstate, (GIBaseInfo *)closure->info,
+                                                 &closure->py_profile_function);
+        if (py_profile_function == NULL) {
+            PyErr_Clear();
+        }
+    }
 
-    py_args = PyTuple_New(n_args);
-    if (py_args == NULL) {
-        PyErr_Clear();
-        goto end;
+    py_args = closure->py_args;
+    if (py_args != NULL) {
+        closure->py_args = NULL;
+    } else {
+        py_args = PyTuple_New(closure->n_py_args);
+        if (py_args == NULL) {
+            PyErr_Clear();
+            goto out;
+        }
     }
 
     n_in_args = 0;
 
-    for (i = 0; i < n_args; i++) {
-        arg_info = g_callable_info_get_arg (closure->info, i);
-        arg_type = g_arg_info_get_type (arg_info);
-        arg_transfer = g_arg_info_get_ownership_transfer(arg_info);
-        arg_tag = g_type_info_get_tag(arg_type);
-        arg_direction = g_arg_info_get_direction(arg_info);
-        switch (arg_tag){
-            case GI_TYPE_TAG_VOID:
-                {
-                    if (g_type_info_is_pointer(arg_type)) {
-                        if (PyTuple_SetItem(py_args, n_in_args, closure->user_data) != 0) {
-                            PyErr_Clear();
-                            goto end;
-                        }
-                        n_in_args++;
-                        continue;
-                    }
+    for (i = 0; i < closure->n_args; i++) {
+        PyGIClosureArg *arg = &closure->args[i];
+
+        switch (arg->kind) {
+            case _PYGI_CLOSURE_ARG_USER_DATA:
+                pyarg = closure->user_data != NULL ? closure->user_data : Py_None;
+                Py_INCREF(pyarg);
+                break;
+            case _PYGI_CLOSURE_ARG_VALUE:
+                pyarg = _pygi_argument_to_object (args[i],
+                                                  arg->type_info,
+                                                  arg->transfer);
+                if (pyarg == NULL) {
+                    PyErr_Clear();
+                    Py_DECREF(py_args);
+                    goto out;
                 }
-            case GI_TYPE_TAG_ERROR:
-                 {
-                     continue;
-                 }
+                break;
             default:
-                {
-                    pyarg = _pygi_argument_to_object (args[i],
-                                                      arg_type,
-                                                      arg_transfer);
-                    
-                    if(PyTuple_SetItem(py_args, n_in_args, pyarg) != 0) {
-                        PyErr_Clear();
-                        goto end;
-                    }
-                    n_in_args++;
-                    g_base_info_unref((GIBaseInfo*)arg_info);
-                    g_base_info_unref((GIBaseInfo*)arg_type);                                    
-                }
+                continue;
         }
-        
+
+        PyTuple_SET_ITEM(py_args, n_in_args, pyarg);
+        n_in_args++;
     }
 
-    if(_PyTuple_Resize (&py_args, n_in_args) != 0) {
-        PyErr_Clear();
-        goto end;
+    if (G_UNLIKELY(start != 0)) {
+        times[_PYGI_STATS_INPUT] = _pygi_stats_now() - start;
+        start += times[_PYGI_STATS_INPUT];
     }
 
     retval = PyObject_CallObject((PyObject *)closure->function, py_args);
 
-    Py_DECREF(py_args);
+    if (G_UNLIKELY(start != 0)) {
+        times[_PYGI_STATS_CALL] = _pygi_stats_now() - start;
+        start += times[_PYGI_STATS_CALL];
+    }
+
+    /* Keep the tuple for the next invocation if the callable didn't. */
+    if (py_args->ob_refcnt == 1 && closure->py_args == NULL) {
+        for (i = 0; i < n_in_args; i++) {
+            Py_CLEAR(PyTuple_GET_ITEM(py_args, i));
+        }
+        closure->py_args = py_args;
+    } else {
+        Py_DECREF(py_args);
+    }
 
     if (retval == NULL) {
-        goto end;
+        goto out;
     }
 
-    *(GArgument*)result = _pygi_argument_from_object(retval, return_type, return_transfer);
+    *(GArgument*)result = _pygi_argument_from_object(retval, closure->return_type_info,
+                                                     closure->return_transfer);
 
-end:
-    g_base_info_unref((GIBaseInfo*)return_type);
+    if (G_UNLIKELY(start != 0)) {
+        times[_PYGI_STATS_OUTPUT] = _pygi_stats_now() - start;
+    }
 
-    PyGILState_Release(state);
+out:
+    /* Failed invocations are counted too, with the phases they went
+     * through. */
+    if (G_UNLIKELY(start != 0)) {
+        if (closure->stats == NULL) {
+            closure->stats = _pygi_stats_get((GIBaseInfo *)closure->info);
+        }
+        _pygi_stats_record(closure->stats, times, retval == NULL || PyErr_Occurred());
+    }
 
-    if (closure->user_data)
-        Py_XDECREF(closure->user_data);
+    if (G_UNLIKELY(py_profile_function != NULL)) {
+        _pygi_profile_return(tstate, py_profile_function, retval == NULL);
+    }
 
+    PYGI_PROBE2(closure__return, closure->name, retval == NULL);
+}
+
+void
+_pygi_closure_finish (PyGICClosure *closure)
+{
     /* Now that the closure has finished we can make a decision about how
-       to free it.  Scope call gets free'd now, scope notified will be freed
-       when the notify is called and we can free async anytime we want
+       to free it.  Scope call gets free'd once the function it was given to
+       returns, as it may be called more than once, scope notified will be
+       freed when the notify is called and we can free async anytime we want
        once we return from this function */
     switch (closure->scope) {
     case GI_SCOPE_TYPE_CALL:
-        _pygi_invoke_closure_free(closure);
-        break;
     case GI_SCOPE_TYPE_NOTIFIED:        
         break;
     case GI_SCOPE_TYPE_ASYNC:
-        /* Append this PyGICClosure to a list of closure that we will free
-           after we're done with this function invokation */
-        async_free_list = g_slist_prepend(async_free_list, closure);
+        /* This closure is still running, so free the others now if there
+           are too many, and push it to be freed once this handler has
+           returned */
+        if (g_atomic_int_get(&async_free_n_closures) >= _PYGI_ASYNC_FREE_THRESHOLD)
+            _pygi_closure_async_free_drain();
+
+        _pygi_closure_async_free_push(closure);
+
+        if (g_atomic_int_compare_and_exchange(&async_free_idle_pending, FALSE, TRUE))
+            g_idle_add(_pygi_closure_async_free_idle, NULL);
         break;
     default:
         g_assert_not_reached();
     }
 }
 
+void
+_pygi_closure_handle (ffi_cif *cif,
+                      void    *result,
+                      void   **args,
+                      void    *data)
+{
+    PyGILState_STATE state;
+    PyThreadState *thread_state;
+    gboolean gil_held;
+    PyGICClosure *closure = data;
+
+    /* The closure can't be pooled or freed until this returns */
+    g_atomic_int_inc(&closure->n_running);
+
+    /* Synchronous callbacks are called from within invoke, on the thread
+      which holds the GIL already.  Otherwise, lock the GIL as we are
+      coming into this code without the lock and we may be executing
+      python code.  The current thread state is read directly, as
+      PyThreadState_GET() aborts on debug builds when it is NULL */
+    thread_state = PyGILState_GetThisThreadState();
+    gil_held = thread_state != NULL && thread_state == _PyThreadState_Current;
+
+    /* Unless the callback is to be queued, in which case the consumer
+      finishes it once it has run */
+    if (!gil_held && closure->queued && _pygi_dispatch_enqueue(closure, args)) {
+        g_atomic_int_add(&closure->n_running, -1);
+        return;
+    }
+
+    if (!gil_held)
+        state = PyGILState_Ensure();
+
+    _pygi_closure_invoke(closure, args, result);
+
+    if (!gil_held)
+        PyGILState_Release(state);
+
+    _pygi_closure_finish(closure);
+
+    g_atomic_int_add(&closure->n_running, -1);
+}
+
+/* Only values which don't point to memory owned by the caller can be kept
+ * past the invocation. */
+static gsize
+_pygi_closure_arg_copy_size (GITypeInfo *type_info)
+{
+    GITypeTag type_tag;
+    gsize size = 0;
+
+    if (g_type_info_is_pointer(type_info)) {
+        return 0;
+    }
+
+    type_tag = g_type_info_get_tag(type_info);
+    switch (type_tag) {
+        case GI_TYPE_TAG_INTERFACE:
+        {
+            GIBaseInfo *info;
+            GIInfoType info_type;
+
+            info = g_type_info_get_interface(type_info);
+            info_type = g_base_info_get_type(info);
+            if (info_type == GI_INFO_TYPE_ENUM || info_type == GI_INFO_TYPE_FLAGS) {
+                size = sizeof(gint);
+            }
+            g_base_info_unref(info);
+            break;
+        }
+        case GI_TYPE_TAG_VOID:
+        case GI_TYPE_TAG_UTF8:
+        case GI_TYPE_TAG_FILENAME:
+        case GI_TYPE_TAG_ARRAY:
+        case GI_TYPE_TAG_GLIST:
+        case GI_TYPE_TAG_GSLIST:
+        case GI_TYPE_TAG_GHASH:
+        case GI_TYPE_TAG_ERROR:
+            break;
+        default:
+            size = _pygi_g_type_tag_size(type_tag);
+            break;
+    }
+
+    return size;
+}
+
+static void
+_pygi_closure_plan_build (PyGICClosure *closure)
+{
+    gsize i;
+
+    closure->name = _pygi_g_callable_info_get_qualified_name(closure->info);
+
+    closure->return_type_info = g_callable_info_get_return_type(closure->info);
+    closure->return_transfer = g_callable_info_get_caller_owns(closure->info);
+
+    closure->queueable = g_type_info_get_tag(closure->return_type_info) == GI_TYPE_TAG_VOID
+            && !g_type_info_is_pointer(closure->return_type_info);
+
+    closure->n_args = g_callable_info_get_n_args(closure->info);
+    closure->n_py_args = 0;
+    closure->args = g_new0(PyGIClosureArg, closure->n_args);
+
+    for (i = 0; i < closure->n_args; i++) {
+        PyGIClosureArg *arg = &closure->args[i];
+        GIArgInfo *arg_info;
+        GITypeInfo *type_info;
+
+        arg_info = g_callable_info_get_arg(closure->info, i);
+        type_info = g_arg_info_get_type(arg_info);
+
+        switch (g_type_info_get_tag(type_info)) {
+            case GI_TYPE_TAG_VOID:
+                arg->kind = g_type_info_is_pointer(type_info)
+                        ? _PYGI_CLOSURE_ARG_USER_DATA : _PYGI_CLOSURE_ARG_SKIP;
+                break;
+            case GI_TYPE_TAG_ERROR:
+                arg->kind = _PYGI_CLOSURE_ARG_SKIP;
+                break;
+            default:
+                arg->kind = _PYGI_CLOSURE_ARG_VALUE;
+                break;
+        }
+
+        if (arg->kind == _PYGI_CLOSURE_ARG_VALUE) {
+            arg->type_info = type_info;
+            arg->transfer = g_arg_info_get_ownership_transfer(arg_info);
+            arg->size = _pygi_closure_arg_copy_size(type_info);
+            if (arg->size == 0) {
+                closure->queueable = FALSE;
+            }
+        } else {
+            g_base_info_unref((GIBaseInfo *)type_info);
+        }
+
+        if (arg->kind != _PYGI_CLOSURE_ARG_SKIP) {
+            closure->n_py_args++;
+        }
+
+        g_base_info_unref((GIBaseInfo *)arg_info);
+    }
+}
+
+static void
+_pygi_closure_plan_free (PyGICClosure *closure)
+{
+    gsize i;
+
+    g_free(closure->name);
+
+    for (i = 0; i < closure->n_args; i++) {
+        if (closure->args[i].type_info != NULL) {
+            g_base_info_unref((GIBaseInfo *)closure->args[i].type_info);
+        }
+    }
+    g_free(closure->args);
+
+    if (closure->return_type_info != NULL) {
+        g_base_info_unref((GIBaseInfo *)closure->return_type_info);
+    }
+}
+
+/* The GIL must be held. */
+static void
+_pygi_closure_destroy (PyGICClosure *closure)
+{
+    Py_CLEAR(closure->py_args);
+
+    g_callable_info_free_closure(closure->info, closure->closure);
+
+    _pygi_closure_plan_free(closure);
+
+    if (closure->info)
+        g_base_info_unref((GIBaseInfo*)closure->info);
+
+    g_slice_free(PyGICClosure, closure);
+}
+
+static PyGICClosure *
+_pygi_closure_pool_pop (GICallableInfo *info)
+{
+    gchar *name;
+    GQueue *pool;
+
+    if (closure_pools == NULL || g_base_info_get_name((GIBaseInfo *)info) == NULL) {
+        return NULL;
+    }
+
+    name = _pygi_g_callable_info_get_qualified_name(info);
+    pool = g_hash_table_lookup(closure_pools, name);
+    g_free(name);
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    return g_queue_pop_head(pool);
+}
+
+/* Closures still referenced by a queued invocation or by a running handler
+ * must not be pooled, or the next callback would reuse a live trampoline. */
+static gboolean
+_pygi_closure_pool_push (PyGICClosure *closure)
+{
+    GQueue *pool;
+
+    if (g_atomic_int_get(&closure->n_queued) > 0
+            || g_atomic_int_get(&closure->n_running) > 0) {
+        return FALSE;
+    }
+
+    if (g_base_info_get_name((GIBaseInfo *)closure->info) == NULL) {
+        return FALSE;
+    }
+
+    if (closure_pools == NULL) {
+        closure_pools = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    }
+
+    pool = g_hash_table_lookup(closure_pools, closure->name);
+    if (pool == NULL) {
+        pool = g_queue_new();
+        g_hash_table_insert(closure_pools, g_strdup(closure->name), pool);
+    }
+
+    if (pool->length >= closure_pool_capacity) {
+        return FALSE;
+    }
+
+    g_queue_push_head(pool, closure);
+
+    return TRUE;
+}
+
+typedef struct {
+    gsize n_kept;
+    gsize n_freed;
+} PyGIClosureTrim;
+
+static void
+_pygi_closure_pool_trim (gpointer key,
+                         gpointer value,
+                         gpointer user_data)
+{
+    GQueue *pool = value;
+    PyGIClosureTrim *trim = user_data;
+
+    while (pool->length > trim->n_kept) {
+        _pygi_closure_destroy(g_queue_pop_tail(pool));
+        trim->n_freed++;
+    }
+}
+
+/* Free the finished async closures, and release what is over n_kept in
+ * every closure pool. */
+gsize
+_pygi_closure_trim (gsize n_kept)
+{
+    PyGIClosureTrim trim = { n_kept, 0 };
+
+    _pygi_closure_async_free_drain();
+
+    if (closure_pools != NULL) {
+        g_hash_table_foreach(closure_pools, _pygi_closure_pool_trim, &trim);
+    }
+
+    return trim.n_freed;
+}
+
+void
+_pygi_closure_set_pool_capacity (gsize capacity)
+{
+    closure_pool_capacity = capacity;
+    _pygi_closure_trim(capacity);
+}
+
 void _pygi_invoke_closure_free(gpointer data)
 {
     PyGICClosure* invoke_closure = (PyGICClosure *)data;
-    
+    PyGILState_STATE state;
 
-    Py_DECREF(invoke_closure->function);
+    state = PyGILState_Ensure();
+
+    /* The consumer frees it after the last queued invocation. */
+    if (g_atomic_int_get(&invoke_closure->n_queued) > 0) {
+        invoke_closure->free_when_dispatched = TRUE;
+        PyGILState_Release(state);
+        return;
+    }
 
-    g_callable_info_free_closure(invoke_closure->info,
-                                 invoke_closure->closure);
+    /* A handler still runs it, possibly the one freeing it: try again once
+     * it has returned. */
+    if (g_atomic_int_get(&invoke_closure->n_running) > 0) {
+        _pygi_closure_async_free_defer(invoke_closure, TRUE);
+        PyGILState_Release(state);
+        return;
+    }
+
+    Py_CLEAR(invoke_closure->function);
+    Py_CLEAR(invoke_closure->user_data);
 
-    if (invoke_closure->info)
-        g_base_info_unref((GIBaseInfo*)invoke_closure->info);
+    if (!_pygi_closure_pool_push(invoke_closure)) {
+        _pygi_closure_destroy(invoke_closure);
+    }
 
-    g_slice_free(PyGICClosure, invoke_closure);
+    PyGILState_Release(state);
 }
 
 
@@ -178,24 +585,48 @@ _pygi_make_native_closure (GICallableInfo* info,
     ffi_closure *fficlosure;
 
     /* Begin by cleaning up old async functions */
-    g_slist_foreach(async_free_list, (GFunc)_pygi_invoke_closure_free, NULL);
-    g_slist_free(async_free_list);
-    async_free_list = NULL;
+    _pygi_closure_async_free_drain();
+
+    /* Build the closure itself, unless one is available for the type */
+    closure = _pygi_closure_pool_pop(info);
+    if (closure == NULL) {
+        closure = g_slice_new0(PyGICClosure);   
+        closure->info = (GICallableInfo *) g_base_info_ref ((GIBaseInfo *) info);  
+
+        _pygi_closure_plan_build(closure);
+
+        fficlosure =
+            g_callable_info_prepare_closure (info, &closure->cif, _pygi_closure_handle,
+                                             closure);
+        closure->closure = fficlosure;
+    }
+
+    closure->queued = FALSE;
+    closure->coalesce = FALSE;
+    closure->free_when_dispatched = FALSE;
+
+    if (_pygi_queued_check(py_function)) {
+        if (!closure->queueable) {
+            PyErr_Format(PyExc_TypeError,
+                    "%s can't be queued: it returns a value or takes arguments which can't be copied",
+                    g_base_info_get_name((GIBaseInfo *)info));
+            if (!_pygi_closure_pool_push(closure)) {
+                _pygi_closure_destroy(closure);
+            }
+            return NULL;
+        }
+
+        closure->queued = TRUE;
+        closure->coalesce = ((PyGIQueued *)py_function)->coalesce;
+        py_function = ((PyGIQueued *)py_function)->function;
+    }
 
-    /* Build the closure itself */
-    closure = g_slice_new0(PyGICClosure);   
-    closure->info = (GICallableInfo *) g_base_info_ref ((GIBaseInfo *) info);  
     closure->function = py_function;
     closure->user_data = py_user_data;
 
     Py_INCREF(py_function);
     if (closure->user_data)
         Py_INCREF(closure->user_data);
-
-    fficlosure =
-        g_callable_info_prepare_closure (info, &closure->cif, _pygi_closure_handle,
-                                         closure);
-    closure->closure = fficlosure;
     
     /* Give the closure the information it needs to determine when
        to free itself later */
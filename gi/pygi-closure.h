@@ -24,11 +24,27 @@
 #include <girffi.h>
 #include <ffi.h>
 
+#include "pygi-stats.h"
+
 G_BEGIN_DECLS
 
 
 /* Private */
 
+typedef enum {
+    _PYGI_CLOSURE_ARG_VALUE,
+    _PYGI_CLOSURE_ARG_USER_DATA,
+    _PYGI_CLOSURE_ARG_SKIP
+} PyGIClosureArgKind;
+
+typedef struct {
+    PyGIClosureArgKind kind;
+    GITypeInfo *type_info;
+    GITransfer transfer;
+    /* Size of the value if it can be copied to be marshalled later. */
+    gsize size;
+} PyGIClosureArg;
+
 typedef struct _PyGICClosure
 {
     GICallableInfo *info;
@@ -40,13 +56,52 @@ typedef struct _PyGICClosure
     GIScopeType scope;
 
     PyObject* user_data;
+
+    /* Computed when the closure is made, so that the handler doesn't have
+     * to query the callable info on every invocation. */
+    gchar *name;
+    gsize n_args;
+    gsize n_py_args;
+    PyGIClosureArg *args;
+    GITypeInfo *return_type_info;
+    GITransfer return_transfer;
+    /* Whether the arguments can be copied and nothing is returned. */
+    gboolean queueable;
+
+    /* Invocations from threads which don't hold the GIL are queued, to be
+     * dispatched in batches with the GIL held. */
+    gboolean queued;
+    gboolean coalesce;
+    volatile gint n_queued;
+    gboolean free_when_dispatched;
+
+    /* Handlers running it, on any thread. */
+    volatile gint n_running;
+
+    /* Argument tuple kept from the last invocation, if nothing else
+     * referenced it; taken while the closure runs. */
+    PyObject *py_args;
+
+    PyGIStats *stats;
+    PyObject *py_profile_function;
+
+    /* Links finished async closures waiting to be freed. */
+    struct _PyGICClosure *next_free;
 } PyGICClosure; 
  
 void _pygi_closure_handle(ffi_cif *cif, void *result, void
                           **args, void *userdata);
+
+void _pygi_closure_invoke (PyGICClosure *closure,
+                           void        **args,
+                           void         *result);
+void _pygi_closure_finish (PyGICClosure *closure);
  
 void _pygi_invoke_closure_free(gpointer user_data);
 
+gsize _pygi_closure_trim (gsize n_kept);
+void _pygi_closure_set_pool_capacity (gsize capacity);
+
 PyGICClosure* _pygi_make_native_closure (GICallableInfo* info,
                                          GIArgInfo* arg_info,
                                          PyObject *function,
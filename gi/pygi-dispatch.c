@@ -0,0 +1,267 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-dispatch.c: queued dispatch of callbacks from other threads.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+#include <string.h>
+
+/* A queued invocation, with copies of the argument values. */
+typedef struct _PyGIDispatchCall {
+    struct _PyGIDispatchCall *next;
+    PyGICClosure *closure;
+    gpointer *args;
+    GArgument values[1];
+} PyGIDispatchCall;
+
+/* Invocations are pushed without locking from any thread, and the whole
+ * stack is taken at once by the consumer, which runs it with the GIL held
+ * either from an idle handler or from gi.dispatch_pending().  The idle
+ * handler is attached to the default main context, so without a main loop
+ * running it, queued invocations are only delivered by
+ * gi.dispatch_pending(). */
+static PyGIDispatchCall * volatile dispatch_calls;
+static volatile gint dispatch_idle_pending;
+
+static gboolean
+_pygi_dispatch_idle (gpointer user_data)
+{
+    PyGILState_STATE state;
+
+    g_atomic_int_set(&dispatch_idle_pending, FALSE);
+
+    state = PyGILState_Ensure();
+    _pygi_dispatch_pending();
+    PyGILState_Release(state);
+
+    return FALSE;
+}
+
+/* Called without the GIL.  Returns FALSE if the invocation can't be
+ * queued, in which case it must be run right away. */
+gboolean
+_pygi_dispatch_enqueue (PyGICClosure *closure,
+                        void        **args)
+{
+    PyGIDispatchCall *call;
+    PyGIDispatchCall *head;
+    gsize i, n_values;
+
+    if (!closure->queueable) {
+        return FALSE;
+    }
+
+    g_atomic_int_inc(&closure->n_queued);
+
+    n_values = MAX(closure->n_args, 1);
+    call = g_malloc(G_STRUCT_OFFSET(PyGIDispatchCall, values)
+            + n_values * (sizeof(GArgument) + sizeof(gpointer)));
+    call->closure = closure;
+    call->args = (gpointer *)&call->values[n_values];
+
+    for (i = 0; i < closure->n_args; i++) {
+        call->args[i] = &call->values[i];
+        if (closure->args[i].kind == _PYGI_CLOSURE_ARG_VALUE) {
+            memcpy(&call->values[i], args[i], closure->args[i].size);
+        }
+    }
+
+    do {
+        head = g_atomic_pointer_get(&dispatch_calls);
+        call->next = head;
+    } while (!g_atomic_pointer_compare_and_exchange(&dispatch_calls, head, call));
+
+    if (g_atomic_int_compare_and_exchange(&dispatch_idle_pending, FALSE, TRUE)) {
+        g_idle_add(_pygi_dispatch_idle, NULL);
+    }
+
+    return TRUE;
+}
+
+/* Releases the closure reference held by a run or dropped invocation. */
+static void
+_pygi_dispatch_call_free (PyGIDispatchCall *call)
+{
+    PyGICClosure *closure = call->closure;
+
+    if (g_atomic_int_dec_and_test(&closure->n_queued)
+            && closure->free_when_dispatched) {
+        _pygi_invoke_closure_free(closure);
+    } else {
+        _pygi_closure_finish(closure);
+    }
+
+    g_free(call);
+}
+
+/* The GIL must be held.  Returns the number of invocations run. */
+gsize
+_pygi_dispatch_pending (void)
+{
+    PyGIDispatchCall *calls;
+    PyGIDispatchCall *call;
+    PyGIDispatchCall *kept;
+    GHashTable *coalesced = NULL;
+    gsize n_calls = 0;
+
+    do {
+        calls = g_atomic_pointer_get(&dispatch_calls);
+    } while (calls != NULL
+             && !g_atomic_pointer_compare_and_exchange(&dispatch_calls, calls, NULL));
+
+    /* Run them in the order they were queued.  The stack holds the newest
+     * first, so only the first invocation seen of a coalescing closure is
+     * kept, and the older ones are dropped. */
+    kept = NULL;
+    while (calls != NULL) {
+        PyGIDispatchCall *next = calls->next;
+
+        call = calls;
+        calls = next;
+
+        if (call->closure->coalesce) {
+            if (coalesced == NULL) {
+                coalesced = g_hash_table_new(NULL, NULL);
+            }
+            if (g_hash_table_lookup(coalesced, call->closure) != NULL) {
+                _pygi_dispatch_call_free(call);
+                continue;
+            }
+            g_hash_table_insert(coalesced, call->closure, call);
+        }
+
+        call->next = kept;
+        kept = call;
+    }
+
+    if (coalesced != NULL) {
+        g_hash_table_destroy(coalesced);
+    }
+
+    while (kept != NULL) {
+        GArgument result;
+
+        call = kept;
+        kept = call->next;
+
+        _pygi_closure_invoke(call->closure, call->args, &result);
+        if (PyErr_Occurred()) {
+            PyErr_Print();
+        }
+
+        _pygi_dispatch_call_free(call);
+        n_calls++;
+    }
+
+    return n_calls;
+}
+
+static PyObject *
+_queued_new (PyTypeObject *type,
+             PyObject     *args,
+             PyObject     *kwargs)
+{
+    static char *kwlist[] = { "function", "coalesce", NULL };
+
+    PyObject *function;
+    PyObject *py_coalesce = Py_False;
+    PyGIQueued *self;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O:Queued.__new__",
+            kwlist, &function, &py_coalesce)) {
+        return NULL;
+    }
+
+    if (!PyCallable_Check(function)) {
+        PyErr_Format(PyExc_TypeError, "must be callable, not %s",
+                function->ob_type->tp_name);
+        return NULL;
+    }
+
+    self = (PyGIQueued *)type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(function);
+    self->function = function;
+    self->coalesce = PyObject_IsTrue(py_coalesce);
+
+    return (PyObject *)self;
+}
+
+static void
+_queued_dealloc (PyGIQueued *self)
+{
+    Py_CLEAR(self->function);
+
+    self->ob_type->tp_free((PyObject *)self);
+}
+
+static PyObject *
+_queued_call (PyGIQueued *self,
+              PyObject   *args,
+              PyObject   *kwargs)
+{
+    return PyObject_Call(self->function, args, kwargs);
+}
+
+PyTypeObject PyGIQueued_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0,
+    "gi.Queued",                               /* tp_name */
+    sizeof(PyGIQueued),                        /* tp_basicsize */
+    0,                                         /* tp_itemsize */
+    (destructor)_queued_dealloc,               /* tp_dealloc */
+    (printfunc)NULL,                           /* tp_print */
+    (getattrfunc)NULL,                         /* tp_getattr */
+    (setattrfunc)NULL,                         /* tp_setattr */
+    (cmpfunc)NULL,                             /* tp_compare */
+    (reprfunc)NULL,                            /* tp_repr */
+    NULL,                                      /* tp_as_number */
+    NULL,                                      /* tp_as_sequence */
+    NULL,                                      /* tp_as_mapping */
+    (hashfunc)NULL,                            /* tp_hash */
+    (ternaryfunc)_queued_call,                 /* tp_call */
+    (reprfunc)NULL,                            /* tp_str */
+    (getattrofunc)NULL,                        /* tp_getattro */
+    (setattrofunc)NULL,                        /* tp_setattro */
+    NULL,                                      /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags */
+    "Queued(function, coalesce=False)\n\n"
+    "Wraps a callback so that invocations from threads which don't hold\n"
+    "the GIL are queued and run later on the thread dispatching them:\n"
+    "from an idle handler on the default main context, or by\n"
+    "gi.dispatch_pending() when no main loop runs there.  Only callbacks\n"
+    "returning nothing, whose arguments can be copied, can be queued;\n"
+    "others raise TypeError when passed.  With coalesce, only the latest\n"
+    "pending invocation is run.",              /* tp_doc */
+};
+
+void
+_pygi_dispatch_register_types (PyObject *m)
+{
+    PyGIQueued_Type.ob_type = &PyType_Type;
+    PyGIQueued_Type.tp_new = (newfunc)_queued_new;
+    if (PyType_Ready(&PyGIQueued_Type))
+        return;
+    if (PyModule_AddObject(m, "Queued", (PyObject *)&PyGIQueued_Type))
+        return;
+}
@@ -0,0 +1,52 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-dispatch.h: queued dispatch of callbacks from other threads.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_DISPATCH_H__
+#define __PYGI_DISPATCH_H__
+
+#include <Python.h>
+
+#include "pygi-closure.h"
+
+G_BEGIN_DECLS
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *function;
+    gboolean coalesce;
+} PyGIQueued;
+
+
+/* Private */
+
+extern PyTypeObject PyGIQueued_Type;
+
+#define _pygi_queued_check(object) PyObject_TypeCheck(object, &PyGIQueued_Type)
+
+gboolean _pygi_dispatch_enqueue (PyGICClosure *closure,
+                                 void        **args);
+gsize _pygi_dispatch_pending (void);
+
+void _pygi_dispatch_register_types (PyObject *m);
+
+G_END_DECLS
+
+#endif /* __PYGI_DISPATCH_H__ */
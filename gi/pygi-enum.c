@@ -0,0 +1,303 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-enum.c: enum and flags wrapper classes.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+#include <pygobject.h>
+
+/* Values of an enum get a dense index unless they are spread over a range
+ * larger than this many times their number. */
+#define _PYGI_ENUM_MAX_SPREAD 4
+
+/* An index over the __enum_values__ singletons of pygobject, which stay the
+ * only instances of the values. */
+typedef struct {
+    glong min;
+    gsize n_values;
+    PyObject **values;
+} PyGIEnumTable;
+
+static GQuark _pygi_enum_table_quark = 0;
+
+/* Combinations of flags are not singletons in pygobject, a new object is
+ * made whenever a combination is returned.  Up to this many combinations
+ * per type are added to __flags_values__, so that pygobject finds them
+ * too. */
+#define _PYGI_FLAGS_MAX_COMBINATIONS 64
+
+typedef struct {
+    PyObject *values;
+    gsize n_free;
+} PyGIFlagsTable;
+
+static GQuark _pygi_flags_table_quark = 0;
+
+static PyGIEnumTable *
+_pygi_enum_table_new (PyObject *py_type,
+                      glong     min,
+                      glong     max,
+                      gsize     n_values)
+{
+    PyGIEnumTable *table;
+    PyObject *py_values;
+    PyObject *py_key;
+    PyObject *py_value;
+    Py_ssize_t pos;
+
+    /* Computed in 64 bits, as enums may span the whole range of gint. */
+    if (n_values == 0
+            || (guint64)((gint64)max - (gint64)min) >= (guint64)n_values * _PYGI_ENUM_MAX_SPREAD) {
+        return NULL;
+    }
+
+    py_values = PyDict_GetItemString(((PyTypeObject *)py_type)->tp_dict, "__enum_values__");
+    if (py_values == NULL || !PyDict_Check(py_values)) {
+        return NULL;
+    }
+
+    table = g_slice_new(PyGIEnumTable);
+    table->min = min;
+    table->n_values = max - min + 1;
+    table->values = g_new0(PyObject *, table->n_values);
+
+    pos = 0;
+    while (PyDict_Next(py_values, &pos, &py_key, &py_value)) {
+        glong value;
+
+        if (!PyInt_Check(py_key)) {
+            continue;
+        }
+        value = PyInt_AS_LONG(py_key);
+        if (value < min || value > max) {
+            continue;
+        }
+
+        /* The table holds a reference, as the dictionary might be replaced. */
+        Py_INCREF(py_value);
+        table->values[value - min] = py_value;
+    }
+
+    return table;
+}
+
+static PyGIFlagsTable *
+_pygi_flags_table_new (PyObject *py_type)
+{
+    PyGIFlagsTable *table;
+    PyObject *py_values;
+
+    py_values = PyDict_GetItemString(((PyTypeObject *)py_type)->tp_dict, "__flags_values__");
+    if (py_values == NULL || !PyDict_Check(py_values)) {
+        return NULL;
+    }
+
+    table = g_slice_new(PyGIFlagsTable);
+    Py_INCREF(py_values);
+    table->values = py_values;
+    table->n_free = _PYGI_FLAGS_MAX_COMBINATIONS;
+
+    return table;
+}
+
+/* The GIL must be held. */
+static PyObject *
+_pygi_flags_table_get (PyGIFlagsTable *table,
+                       GType           g_type,
+                       glong           value)
+{
+    PyObject *py_key;
+    PyObject *py_value;
+
+    py_key = PyInt_FromLong(value);
+    if (py_key == NULL) {
+        return NULL;
+    }
+
+    py_value = PyDict_GetItem(table->values, py_key);
+    if (py_value != NULL) {
+        Py_DECREF(py_key);
+        Py_INCREF(py_value);
+        return py_value;
+    }
+
+    py_value = pyg_flags_from_gtype(g_type, value);
+
+    if (py_value != NULL && table->n_free > 0) {
+        if (PyDict_SetItem(table->values, py_key, py_value) < 0) {
+            PyErr_Clear();
+        } else {
+            table->n_free--;
+        }
+    }
+
+    Py_DECREF(py_key);
+
+    return py_value;
+}
+
+PyObject *
+_pygi_enum_add (PyObject *py_info)
+{
+    GIEnumInfo *info;
+    gboolean is_flags;
+    GType g_type;
+    PyObject *py_type;
+    PyObject *py_namespace;
+    gsize n_values;
+    glong *values;
+    glong min;
+    glong max;
+    gsize i;
+
+    info = (GIEnumInfo *)((PyGIBaseInfo *)py_info)->info;
+    is_flags = g_base_info_get_type((GIBaseInfo *)info) == GI_INFO_TYPE_FLAGS;
+
+    g_type = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *)info);
+    if (is_flags) {
+        py_type = pyg_flags_add(NULL, g_type_name(g_type), NULL, g_type);
+    } else {
+        py_type = pyg_enum_add(NULL, g_type_name(g_type), NULL, g_type);
+    }
+    if (py_type == NULL) {
+        return NULL;
+    }
+
+    py_namespace = PyString_FromString(g_base_info_get_namespace((GIBaseInfo *)info));
+    if (py_namespace == NULL) {
+        goto error;
+    }
+    if (PyObject_SetAttrString(py_type, "__module__", py_namespace) < 0) {
+        Py_DECREF(py_namespace);
+        goto error;
+    }
+    Py_DECREF(py_namespace);
+
+    if (PyObject_SetAttrString(py_type, "__info__", py_info) < 0) {
+        goto error;
+    }
+
+    n_values = g_enum_info_get_n_values(info);
+    values = g_newa(glong, n_values);
+
+    min = G_MAXLONG;
+    max = G_MINLONG;
+    for (i = 0; i < n_values; i++) {
+        GIValueInfo *value_info;
+
+        value_info = g_enum_info_get_value(info, i);
+        values[i] = g_value_info_get_value(value_info);
+        g_base_info_unref((GIBaseInfo *)value_info);
+
+        min = MIN(min, values[i]);
+        max = MAX(max, values[i]);
+    }
+
+    for (i = 0; i < n_values; i++) {
+        GIValueInfo *value_info;
+        gchar *name;
+        PyObject *py_value;
+        int retval;
+
+        if (is_flags) {
+            py_value = pyg_flags_from_gtype(g_type, values[i]);
+        } else {
+            py_value = pyg_enum_from_gtype(g_type, values[i]);
+        }
+        if (py_value == NULL) {
+            goto error;
+        }
+
+        value_info = g_enum_info_get_value(info, i);
+        name = g_ascii_strup(g_base_info_get_name((GIBaseInfo *)value_info), -1);
+        g_base_info_unref((GIBaseInfo *)value_info);
+
+        retval = PyObject_SetAttrString(py_type, name, py_value);
+
+        g_free(name);
+        Py_DECREF(py_value);
+
+        if (retval < 0) {
+            goto error;
+        }
+    }
+
+    if (_pygi_enum_table_quark == 0) {
+        _pygi_enum_table_quark = g_quark_from_static_string("PyGI::enum-table");
+        _pygi_flags_table_quark = g_quark_from_static_string("PyGI::flags-table");
+    }
+
+    if (is_flags && g_type_get_qdata(g_type, _pygi_flags_table_quark) == NULL) {
+        PyGIFlagsTable *table;
+
+        table = _pygi_flags_table_new(py_type);
+        if (table != NULL) {
+            g_type_set_qdata(g_type, _pygi_flags_table_quark, table);
+        }
+    }
+
+    if (!is_flags && g_type_get_qdata(g_type, _pygi_enum_table_quark) == NULL) {
+        PyGIEnumTable *table;
+
+        table = _pygi_enum_table_new(py_type, min, max, n_values);
+        if (table != NULL) {
+            g_type_set_qdata(g_type, _pygi_enum_table_quark, table);
+        }
+    }
+
+    return py_type;
+
+error:
+    Py_DECREF(py_type);
+    return NULL;
+}
+
+PyObject *
+_pygi_enum_from_g_type (GType    g_type,
+                        glong    value,
+                        gboolean is_flags)
+{
+    PyGIEnumTable *table = NULL;
+
+    if (!is_flags && _pygi_enum_table_quark != 0) {
+        table = g_type_get_qdata(g_type, _pygi_enum_table_quark);
+    }
+
+    if (table != NULL
+            && value >= table->min
+            && (gulong)(value - table->min) < table->n_values
+            && table->values[value - table->min] != NULL) {
+        Py_INCREF(table->values[value - table->min]);
+        return table->values[value - table->min];
+    }
+
+    if (is_flags) {
+        PyGIFlagsTable *flags_table = NULL;
+
+        if (_pygi_flags_table_quark != 0) {
+            flags_table = g_type_get_qdata(g_type, _pygi_flags_table_quark);
+        }
+        if (flags_table != NULL) {
+            return _pygi_flags_table_get(flags_table, g_type, value);
+        }
+        return pyg_flags_from_gtype(g_type, value);
+    }
+    return pyg_enum_from_gtype(g_type, value);
+}
@@ -0,0 +1,806 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-field.c: descriptors for struct and object fields.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+#include <pygobject.h>
+#include <structmember.h>
+
+gboolean
+_pygi_field_tag_is_direct (GITypeTag type_tag)
+{
+    switch (type_tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+        case GI_TYPE_TAG_INT8:
+        case GI_TYPE_TAG_UINT8:
+        case GI_TYPE_TAG_INT16:
+        case GI_TYPE_TAG_UINT16:
+        case GI_TYPE_TAG_INT32:
+        case GI_TYPE_TAG_UINT32:
+        case GI_TYPE_TAG_INT64:
+        case GI_TYPE_TAG_UINT64:
+        case GI_TYPE_TAG_SHORT:
+        case GI_TYPE_TAG_USHORT:
+        case GI_TYPE_TAG_INT:
+        case GI_TYPE_TAG_UINT:
+        case GI_TYPE_TAG_LONG:
+        case GI_TYPE_TAG_ULONG:
+        case GI_TYPE_TAG_SSIZE:
+        case GI_TYPE_TAG_SIZE:
+        case GI_TYPE_TAG_FLOAT:
+        case GI_TYPE_TAG_DOUBLE:
+        case GI_TYPE_TAG_TIME_T:
+        case GI_TYPE_TAG_GTYPE:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+void
+_pygi_field_load (gconstpointer address,
+                  GITypeTag     type_tag,
+                  GArgument    *value)
+{
+    switch (type_tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+            value->v_boolean = *(const gboolean *)address;
+            break;
+        case GI_TYPE_TAG_INT8:
+            value->v_int8 = *(const gint8 *)address;
+            break;
+        case GI_TYPE_TAG_UINT8:
+            value->v_uint8 = *(const guint8 *)address;
+            break;
+        case GI_TYPE_TAG_INT16:
+            value->v_int16 = *(const gint16 *)address;
+            break;
+        case GI_TYPE_TAG_UINT16:
+            value->v_uint16 = *(const guint16 *)address;
+            break;
+        case GI_TYPE_TAG_INT32:
+            value->v_int32 = *(const gint32 *)address;
+            break;
+        case GI_TYPE_TAG_UINT32:
+            value->v_uint32 = *(const guint32 *)address;
+            break;
+        case GI_TYPE_TAG_INT64:
+            value->v_int64 = *(const gint64 *)address;
+            break;
+        case GI_TYPE_TAG_UINT64:
+            value->v_uint64 = *(const guint64 *)address;
+            break;
+        case GI_TYPE_TAG_SHORT:
+            value->v_short = *(const gshort *)address;
+            break;
+        case GI_TYPE_TAG_USHORT:
+            value->v_ushort = *(const gushort *)address;
+            break;
+        case GI_TYPE_TAG_INT:
+            value->v_int = *(const gint *)address;
+            break;
+        case GI_TYPE_TAG_UINT:
+            value->v_uint = *(const guint *)address;
+            break;
+        case GI_TYPE_TAG_LONG:
+            value->v_long = *(const glong *)address;
+            break;
+        case GI_TYPE_TAG_ULONG:
+            value->v_ulong = *(const gulong *)address;
+            break;
+        case GI_TYPE_TAG_SSIZE:
+            value->v_ssize = *(const gssize *)address;
+            break;
+        case GI_TYPE_TAG_SIZE:
+            value->v_size = *(const gsize *)address;
+            break;
+        case GI_TYPE_TAG_FLOAT:
+            value->v_float = *(const gfloat *)address;
+            break;
+        case GI_TYPE_TAG_DOUBLE:
+            value->v_double = *(const gdouble *)address;
+            break;
+        case GI_TYPE_TAG_TIME_T:
+            value->v_long = *(const time_t *)address;
+            break;
+        case GI_TYPE_TAG_GTYPE:
+            value->v_long = *(const GType *)address;
+            break;
+        default:
+            g_assert_not_reached();
+    }
+}
+
+void
+_pygi_field_store (gpointer         address,
+                   GITypeTag        type_tag,
+                   const GArgument *value)
+{
+    switch (type_tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+            *(gboolean *)address = value->v_boolean;
+            break;
+        case GI_TYPE_TAG_INT8:
+            *(gint8 *)address = value->v_int8;
+            break;
+        case GI_TYPE_TAG_UINT8:
+            *(guint8 *)address = value->v_uint8;
+            break;
+        case GI_TYPE_TAG_INT16:
+            *(gint16 *)address = value->v_int16;
+            break;
+        case GI_TYPE_TAG_UINT16:
+            *(guint16 *)address = value->v_uint16;
+            break;
+        case GI_TYPE_TAG_INT32:
+            *(gint32 *)address = value->v_int32;
+            break;
+        case GI_TYPE_TAG_UINT32:
+            *(guint32 *)address = value->v_uint32;
+            break;
+        case GI_TYPE_TAG_INT64:
+            *(gint64 *)address = value->v_int64;
+            break;
+        case GI_TYPE_TAG_UINT64:
+            *(guint64 *)address = value->v_uint64;
+            break;
+        case GI_TYPE_TAG_SHORT:
+            *(gshort *)address = value->v_short;
+            break;
+        case GI_TYPE_TAG_USHORT:
+            *(gushort *)address = value->v_ushort;
+            break;
+        case GI_TYPE_TAG_INT:
+            *(gint *)address = value->v_int;
+            break;
+        case GI_TYPE_TAG_UINT:
+            *(guint *)address = value->v_uint;
+            break;
+        case GI_TYPE_TAG_LONG:
+            *(glong *)address = value->v_long;
+            break;
+        case GI_TYPE_TAG_ULONG:
+            *(gulong *)address = value->v_ulong;
+            break;
+        case GI_TYPE_TAG_SSIZE:
+            *(gssize *)address = value->v_ssize;
+            break;
+        case GI_TYPE_TAG_SIZE:
+            *(gsize *)address = value->v_size;
+            break;
+        case GI_TYPE_TAG_FLOAT:
+            *(gfloat *)address = value->v_float;
+            break;
+        case GI_TYPE_TAG_DOUBLE:
+            *(gdouble *)address = value->v_double;
+            break;
+        case GI_TYPE_TAG_TIME_T:
+            *(time_t *)address = value->v_long;
+            break;
+        case GI_TYPE_TAG_GTYPE:
+            *(GType *)address = value->v_long;
+            break;
+        default:
+            g_assert_not_reached();
+    }
+}
+
+/* Enums and flags are stored with their storage type, but marshalled as a long. */
+static glong
+_pygi_field_load_long (gconstpointer address,
+                       GITypeTag     type_tag)
+{
+    switch (type_tag) {
+        case GI_TYPE_TAG_INT8:
+            return *(const gint8 *)address;
+        case GI_TYPE_TAG_UINT8:
+            return *(const guint8 *)address;
+        case GI_TYPE_TAG_INT16:
+            return *(const gint16 *)address;
+        case GI_TYPE_TAG_UINT16:
+            return *(const guint16 *)address;
+        case GI_TYPE_TAG_INT32:
+            return *(const gint32 *)address;
+        case GI_TYPE_TAG_UINT32:
+            return *(const guint32 *)address;
+        case GI_TYPE_TAG_INT64:
+            return *(const gint64 *)address;
+        case GI_TYPE_TAG_UINT64:
+            return *(const guint64 *)address;
+        case GI_TYPE_TAG_SHORT:
+            return *(const gshort *)address;
+        case GI_TYPE_TAG_USHORT:
+            return *(const gushort *)address;
+        case GI_TYPE_TAG_UINT:
+            return *(const guint *)address;
+        case GI_TYPE_TAG_LONG:
+            return *(const glong *)address;
+        case GI_TYPE_TAG_ULONG:
+            return *(const gulong *)address;
+        case GI_TYPE_TAG_INT:
+        default:
+            return *(const gint *)address;
+    }
+}
+
+static void
+_pygi_field_store_long (gpointer  address,
+                        GITypeTag type_tag,
+                        glong     value)
+{
+    switch (type_tag) {
+        case GI_TYPE_TAG_INT8:
+        case GI_TYPE_TAG_UINT8:
+            *(gint8 *)address = value;
+            break;
+        case GI_TYPE_TAG_INT16:
+        case GI_TYPE_TAG_UINT16:
+            *(gint16 *)address = value;
+            break;
+        case GI_TYPE_TAG_INT32:
+        case GI_TYPE_TAG_UINT32:
+            *(gint32 *)address = value;
+            break;
+        case GI_TYPE_TAG_INT64:
+        case GI_TYPE_TAG_UINT64:
+            *(gint64 *)address = value;
+            break;
+        case GI_TYPE_TAG_SHORT:
+        case GI_TYPE_TAG_USHORT:
+            *(gshort *)address = value;
+            break;
+        case GI_TYPE_TAG_LONG:
+        case GI_TYPE_TAG_ULONG:
+            *(glong *)address = value;
+            break;
+        case GI_TYPE_TAG_INT:
+        case GI_TYPE_TAG_UINT:
+        default:
+            *(gint *)address = value;
+            break;
+    }
+}
+
+PyObject *
+_pygi_field_descriptor_get_value (PyGIFieldDescriptor *self,
+                                  PyObject            *instance,
+                                  gpointer             pointer)
+{
+    GArgument value;
+
+    if (self->direct_tag == GI_TYPE_TAG_VOID) {
+        return _pygi_g_field_info_get_value((GIFieldInfo *)((PyGIBaseInfo *)self->py_info)->info,
+                instance, pointer);
+    }
+
+    if (!(self->flags & GI_FIELD_IS_READABLE)) {
+        PyErr_SetString(PyExc_RuntimeError, "field is not readable");
+        return NULL;
+    }
+
+    if (self->enum_type != G_TYPE_INVALID) {
+        return _pygi_enum_from_g_type(self->enum_type,
+                _pygi_field_load_long((guint8 *)pointer + self->offset, self->direct_tag),
+                self->is_flags);
+    }
+
+    _pygi_field_load((guint8 *)pointer + self->offset, self->direct_tag, &value);
+
+    return _pygi_argument_to_object(&value, self->type_info, GI_TRANSFER_NOTHING);
+}
+
+gint
+_pygi_field_descriptor_set_value (PyGIFieldDescriptor *self,
+                                  gpointer             pointer,
+                                  PyObject            *py_value)
+{
+    GArgument value;
+    gint retval;
+
+    retval = _pygi_g_type_info_check_object(self->type_info, py_value);
+    if (retval < 0) {
+        return -1;
+    }
+    if (!retval) {
+        _PyGI_ERROR_PREFIX("%s: ", g_base_info_get_name(((PyGIBaseInfo *)self->py_info)->info));
+        return -1;
+    }
+
+    if (self->direct_tag == GI_TYPE_TAG_VOID) {
+        return _pygi_g_field_info_set_value((GIFieldInfo *)((PyGIBaseInfo *)self->py_info)->info,
+                pointer, py_value);
+    }
+
+    if (!(self->flags & GI_FIELD_IS_WRITABLE)) {
+        PyErr_SetString(PyExc_RuntimeError, "field is not writable");
+        return -1;
+    }
+
+    value = _pygi_argument_from_object(py_value, self->type_info, GI_TRANSFER_NOTHING);
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+
+    if (self->enum_type != G_TYPE_INVALID) {
+        _pygi_field_store_long((guint8 *)pointer + self->offset, self->direct_tag, value.v_long);
+    } else {
+        _pygi_field_store((guint8 *)pointer + self->offset, self->direct_tag, &value);
+    }
+
+    return 0;
+}
+
+static gpointer
+_field_descriptor_get_pointer (PyGIFieldDescriptor *self,
+                               PyObject            *instance)
+{
+    gpointer pointer = NULL;
+
+    if (!PyObject_TypeCheck(instance, self->owner)) {
+        PyErr_Format(PyExc_TypeError, "descriptor '%s' for '%s' objects doesn't apply to '%s' object",
+                g_base_info_get_name(((PyGIBaseInfo *)self->py_info)->info),
+                self->owner->tp_name, instance->ob_type->tp_name);
+        return NULL;
+    }
+
+    switch (self->container_type) {
+        case GI_INFO_TYPE_STRUCT:
+            pointer = pyg_boxed_get(instance, void);
+            break;
+        case GI_INFO_TYPE_OBJECT:
+            pointer = pygobject_get(instance);
+            break;
+        default:
+            PyErr_SetString(PyExc_NotImplementedError, "accessing a field of an union is not supported yet");
+            return NULL;
+    }
+
+    if (pointer == NULL) {
+        PyErr_SetString(PyExc_ValueError, "instance has no underlying structure");
+    }
+
+    return pointer;
+}
+
+static PyObject *
+_field_descriptor_descr_get (PyGIFieldDescriptor *self,
+                             PyObject            *instance,
+                             PyObject            *owner)
+{
+    gpointer pointer;
+
+    if (instance == NULL || instance == Py_None) {
+        Py_INCREF((PyObject *)self);
+        return (PyObject *)self;
+    }
+
+    pointer = _field_descriptor_get_pointer(self, instance);
+    if (pointer == NULL) {
+        return NULL;
+    }
+
+    return _pygi_field_descriptor_get_value(self, instance, pointer);
+}
+
+static int
+_field_descriptor_descr_set (PyGIFieldDescriptor *self,
+                             PyObject            *instance,
+                             PyObject            *py_value)
+{
+    gpointer pointer;
+
+    if (py_value == NULL) {
+        PyErr_Format(PyExc_TypeError, "cannot delete field '%s'",
+                g_base_info_get_name(((PyGIBaseInfo *)self->py_info)->info));
+        return -1;
+    }
+
+    pointer = _field_descriptor_get_pointer(self, instance);
+    if (pointer == NULL) {
+        return -1;
+    }
+
+    return _pygi_field_descriptor_set_value(self, pointer, py_value);
+}
+
+static PyObject *
+_field_descriptor_new (PyTypeObject *type,
+                       PyObject     *args,
+                       PyObject     *kwargs)
+{
+    static char *kwlist[] = { "info", "owner", NULL };
+
+    PyObject *py_info;
+    PyTypeObject *owner;
+    PyGIFieldDescriptor *self;
+    GIFieldInfo *info;
+    GIBaseInfo *container_info;
+    gchar *name;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!O!:FieldDescriptor.__new__",
+            kwlist, &PyGIFieldInfo_Type, &py_info, &PyType_Type, &owner)) {
+        return NULL;
+    }
+
+    info = (GIFieldInfo *)((PyGIBaseInfo *)py_info)->info;
+
+    self = (PyGIFieldDescriptor *)type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(py_info);
+    self->py_info = py_info;
+    Py_INCREF((PyObject *)owner);
+    self->owner = owner;
+
+    name = g_strdelimit(g_strdup(g_base_info_get_name((GIBaseInfo *)info)), "-", '_');
+    self->name = PyString_FromString(name);
+    g_free(name);
+    if (self->name == NULL) {
+        Py_DECREF((PyObject *)self);
+        return NULL;
+    }
+    PyString_InternInPlace(&self->name);
+
+    container_info = g_base_info_get_container((GIBaseInfo *)info);
+    self->container_type = g_base_info_get_type(container_info);
+
+    self->type_info = g_field_info_get_type(info);
+    self->flags = g_field_info_get_flags(info);
+    self->offset = g_field_info_get_offset(info);
+    self->direct_tag = GI_TYPE_TAG_VOID;
+    self->enum_type = G_TYPE_INVALID;
+
+    if (!g_type_info_is_pointer(self->type_info)) {
+        GITypeTag type_tag;
+
+        type_tag = g_type_info_get_tag(self->type_info);
+
+        if (_pygi_field_tag_is_direct(type_tag)) {
+            self->direct_tag = type_tag;
+        } else if (type_tag == GI_TYPE_TAG_INTERFACE) {
+            GIBaseInfo *interface_info;
+            GIInfoType interface_type;
+
+            interface_info = g_type_info_get_interface(self->type_info);
+            interface_type = g_base_info_get_type(interface_info);
+
+            if (interface_type == GI_INFO_TYPE_ENUM || interface_type == GI_INFO_TYPE_FLAGS) {
+                self->direct_tag = g_enum_info_get_storage_type((GIEnumInfo *)interface_info);
+                self->enum_type = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *)interface_info);
+                self->is_flags = interface_type == GI_INFO_TYPE_FLAGS;
+            }
+
+            g_base_info_unref(interface_info);
+        }
+    }
+
+    return (PyObject *)self;
+}
+
+static int
+_field_descriptor_traverse (PyGIFieldDescriptor *self,
+                            visitproc            visit,
+                            void                *arg)
+{
+    Py_VISIT(self->py_info);
+    Py_VISIT((PyObject *)self->owner);
+    return 0;
+}
+
+static int
+_field_descriptor_clear (PyGIFieldDescriptor *self)
+{
+    Py_CLEAR(self->owner);
+    return 0;
+}
+
+static void
+_field_descriptor_dealloc (PyGIFieldDescriptor *self)
+{
+    PyObject_GC_UnTrack((PyObject *)self);
+
+    Py_CLEAR(self->owner);
+    Py_CLEAR(self->name);
+    Py_CLEAR(self->py_info);
+
+    if (self->type_info != NULL) {
+        g_base_info_unref((GIBaseInfo *)self->type_info);
+    }
+
+    self->ob_type->tp_free((PyObject *)self);
+}
+
+static PyMemberDef _field_descriptor_members[] = {
+    { "__info__", T_OBJECT, offsetof(PyGIFieldDescriptor, py_info), READONLY },
+    { "__name__", T_OBJECT, offsetof(PyGIFieldDescriptor, name), READONLY },
+    { "__objclass__", T_OBJECT, offsetof(PyGIFieldDescriptor, owner), READONLY },
+    { NULL }
+};
+
+PyTypeObject PyGIFieldDescriptor_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0,
+    "gi.FieldDescriptor",                      /* tp_name */
+    sizeof(PyGIFieldDescriptor),               /* tp_basicsize */
+    0,                                         /* tp_itemsize */
+    (destructor)_field_descriptor_dealloc,     /* tp_dealloc */
+    (printfunc)NULL,                           /* tp_print */
+    (getattrfunc)NULL,                         /* tp_getattr */
+    (setattrfunc)NULL,                         /* tp_setattr */
+    (cmpfunc)NULL,                             /* tp_compare */
+    (reprfunc)NULL,                            /* tp_repr */
+    NULL,                                      /* tp_as_number */
+    NULL,                                      /* tp_as_sequence */
+    NULL,                                      /* tp_as_mapping */
+    (hashfunc)NULL,                            /* tp_hash */
+    (ternaryfunc)NULL,                         /* tp_call */
+    (reprfunc)NULL,                            /* tp_str */
+    (getattrofunc)NULL,                        /* tp_getattro */
+    (setattrofunc)NULL,                        /* tp_setattro */
+    NULL,                                      /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,   /* tp_flags */
+    NULL,                                      /* tp_doc */
+    (traverseproc)_field_descriptor_traverse,  /* tp_traverse */
+    (inquiry)_field_descriptor_clear,          /* tp_clear */
+    (richcmpfunc)NULL,                         /* tp_richcompare */
+    0,                                         /* tp_weaklistoffset */
+    (getiterfunc)NULL,                         /* tp_iter */
+    (iternextfunc)NULL,                        /* tp_iternext */
+    NULL,                                      /* tp_methods */
+    _field_descriptor_members,                 /* tp_members */
+    NULL,                                      /* tp_getset */
+    (PyTypeObject *)NULL,                      /* tp_base */
+    NULL,                                      /* tp_dict */
+    (descrgetfunc)_field_descriptor_descr_get, /* tp_descr_get */
+    (descrsetfunc)_field_descriptor_descr_set, /* tp_descr_set */
+};
+
+/* Bulk access, using the __fields__ tuple of descriptors set up on the class. */
+
+static PyObject *
+_pygi_fields_get (PyObject  *instance,
+                  gpointer  *pointer)
+{
+    static PyObject *py_fields_name = NULL;
+    PyObject *py_fields;
+
+    if (!PyObject_TypeCheck(instance, &PyGIStruct_Type)
+            && !PyObject_TypeCheck(instance, &PyGIBoxed_Type)) {
+        PyErr_Format(PyExc_TypeError, "must be a gi.Struct or gi.Boxed, not %s",
+                instance->ob_type->tp_name);
+        return NULL;
+    }
+
+    if (py_fields_name == NULL) {
+        py_fields_name = PyString_InternFromString("__fields__");
+        if (py_fields_name == NULL) {
+            return NULL;
+        }
+    }
+
+    py_fields = _PyType_Lookup(instance->ob_type, py_fields_name);
+    if (py_fields == NULL || !PyTuple_Check(py_fields)) {
+        PyErr_Format(PyExc_TypeError, "'%s' object has no field layout",
+                instance->ob_type->tp_name);
+        return NULL;
+    }
+
+    *pointer = pyg_boxed_get(instance, void);
+    if (*pointer == NULL) {
+        PyErr_SetString(PyExc_ValueError, "instance has no underlying structure");
+        return NULL;
+    }
+
+    return py_fields;
+}
+
+PyObject *
+_pygi_fields_as_tuple (PyObject *instance)
+{
+    PyObject *py_fields;
+    PyObject *py_values;
+    gpointer pointer;
+    Py_ssize_t n_fields;
+    Py_ssize_t i;
+
+    py_fields = _pygi_fields_get(instance, &pointer);
+    if (py_fields == NULL) {
+        return NULL;
+    }
+
+    n_fields = PyTuple_GET_SIZE(py_fields);
+
+    py_values = PyTuple_New(n_fields);
+    if (py_values == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < n_fields; i++) {
+        PyObject *py_value;
+
+        py_value = _pygi_field_descriptor_get_value(
+                (PyGIFieldDescriptor *)PyTuple_GET_ITEM(py_fields, i), instance, pointer);
+        if (py_value == NULL) {
+            Py_DECREF(py_values);
+            return NULL;
+        }
+
+        PyTuple_SET_ITEM(py_values, i, py_value);
+    }
+
+    return py_values;
+}
+
+PyObject *
+_pygi_fields_as_dict (PyObject *instance)
+{
+    PyObject *py_fields;
+    PyObject *py_values;
+    gpointer pointer;
+    Py_ssize_t n_fields;
+    Py_ssize_t i;
+
+    py_fields = _pygi_fields_get(instance, &pointer);
+    if (py_fields == NULL) {
+        return NULL;
+    }
+
+    n_fields = PyTuple_GET_SIZE(py_fields);
+
+    py_values = PyDict_New();
+    if (py_values == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < n_fields; i++) {
+        PyGIFieldDescriptor *descriptor;
+        PyObject *py_value;
+        int retval;
+
+        descriptor = (PyGIFieldDescriptor *)PyTuple_GET_ITEM(py_fields, i);
+
+        py_value = _pygi_field_descriptor_get_value(descriptor, instance, pointer);
+        if (py_value == NULL) {
+            Py_DECREF(py_values);
+            return NULL;
+        }
+
+        retval = PyDict_SetItem(py_values, descriptor->name, py_value);
+        Py_DECREF(py_value);
+        if (retval < 0) {
+            Py_DECREF(py_values);
+            return NULL;
+        }
+    }
+
+    return py_values;
+}
+
+static PyGIFieldDescriptor *
+_pygi_fields_find (PyObject *py_fields,
+                   PyObject *py_name)
+{
+    Py_ssize_t n_fields;
+    Py_ssize_t i;
+
+    n_fields = PyTuple_GET_SIZE(py_fields);
+
+    /* Keyword names are usually interned, like the descriptor names. */
+    for (i = 0; i < n_fields; i++) {
+        PyGIFieldDescriptor *descriptor;
+
+        descriptor = (PyGIFieldDescriptor *)PyTuple_GET_ITEM(py_fields, i);
+        if (descriptor->name == py_name) {
+            return descriptor;
+        }
+    }
+
+    if (!PyString_Check(py_name)) {
+        return NULL;
+    }
+
+    for (i = 0; i < n_fields; i++) {
+        PyGIFieldDescriptor *descriptor;
+
+        descriptor = (PyGIFieldDescriptor *)PyTuple_GET_ITEM(py_fields, i);
+        if (_PyString_Eq(descriptor->name, py_name)) {
+            return descriptor;
+        }
+    }
+
+    return NULL;
+}
+
+gint
+_pygi_fields_update (PyObject *instance,
+                     PyObject *args,
+                     PyObject *kwargs)
+{
+    PyObject *py_fields;
+    gpointer pointer;
+    Py_ssize_t n_args;
+    Py_ssize_t i;
+
+    py_fields = _pygi_fields_get(instance, &pointer);
+    if (py_fields == NULL) {
+        return -1;
+    }
+
+    n_args = args != NULL ? PyTuple_GET_SIZE(args) : 0;
+    if (n_args > PyTuple_GET_SIZE(py_fields)) {
+        PyErr_Format(PyExc_TypeError, "%s takes at most %zd field values (%zd given)",
+                instance->ob_type->tp_name, PyTuple_GET_SIZE(py_fields), n_args);
+        return -1;
+    }
+
+    for (i = 0; i < n_args; i++) {
+        if (_pygi_field_descriptor_set_value((PyGIFieldDescriptor *)PyTuple_GET_ITEM(py_fields, i),
+                pointer, PyTuple_GET_ITEM(args, i)) < 0) {
+            return -1;
+        }
+    }
+
+    if (kwargs != NULL) {
+        PyObject *py_name;
+        PyObject *py_value;
+        Py_ssize_t pos = 0;
+
+        while (PyDict_Next(kwargs, &pos, &py_name, &py_value)) {
+            PyGIFieldDescriptor *descriptor;
+            Py_ssize_t j;
+
+            descriptor = _pygi_fields_find(py_fields, py_name);
+            if (descriptor == NULL) {
+                PyErr_Format(PyExc_TypeError, "%s has no field '%s'",
+                        instance->ob_type->tp_name,
+                        PyString_Check(py_name) ? PyString_AS_STRING(py_name) : "?");
+                return -1;
+            }
+
+            for (j = 0; j < n_args; j++) {
+                if (PyTuple_GET_ITEM(py_fields, j) == (PyObject *)descriptor) {
+                    PyErr_Format(PyExc_TypeError, "field '%s' given by position and by keyword",
+                            PyString_AS_STRING(descriptor->name));
+                    return -1;
+                }
+            }
+
+            if (_pygi_field_descriptor_set_value(descriptor, pointer, py_value) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+void
+_pygi_field_register_types (PyObject *m)
+{
+    PyGIFieldDescriptor_Type.ob_type = &PyType_Type;
+    PyGIFieldDescriptor_Type.tp_new = (newfunc)_field_descriptor_new;
+    if (PyType_Ready(&PyGIFieldDescriptor_Type))
+        return;
+    if (PyModule_AddObject(m, "FieldDescriptor", (PyObject *)&PyGIFieldDescriptor_Type))
+        return;
+}
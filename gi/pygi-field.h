@@ -0,0 +1,78 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-field.h: descriptors for struct and object fields.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_FIELD_H__
+#define __PYGI_FIELD_H__
+
+#include <Python.h>
+
+#include <girepository.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *py_info;
+    PyObject *name;
+    PyTypeObject *owner;
+    GITypeInfo *type_info;
+    GIInfoType container_type;
+    GIFieldInfoFlags flags;
+    gsize offset;
+    /* GI_TYPE_TAG_VOID unless the value is stored inline as a scalar. */
+    GITypeTag direct_tag;
+    /* Set for inline enums and flags, stored as direct_tag. */
+    GType enum_type;
+    gboolean is_flags;
+} PyGIFieldDescriptor;
+
+
+/* Private */
+
+extern PyTypeObject PyGIFieldDescriptor_Type;
+
+gboolean _pygi_field_tag_is_direct (GITypeTag type_tag);
+
+void _pygi_field_load (gconstpointer address,
+                       GITypeTag     type_tag,
+                       GArgument    *value);
+void _pygi_field_store (gpointer         address,
+                        GITypeTag        type_tag,
+                        const GArgument *value);
+
+PyObject *_pygi_field_descriptor_get_value (PyGIFieldDescriptor *self,
+                                            PyObject            *instance,
+                                            gpointer             pointer);
+gint _pygi_field_descriptor_set_value (PyGIFieldDescriptor *self,
+                                       gpointer             pointer,
+                                       PyObject            *py_value);
+
+PyObject *_pygi_fields_as_tuple (PyObject *instance);
+PyObject *_pygi_fields_as_dict (PyObject *instance);
+gint _pygi_fields_update (PyObject *instance,
+                          PyObject *args,
+                          PyObject *kwargs);
+
+void _pygi_field_register_types (PyObject *m);
+
+G_END_DECLS
+
+#endif /* __PYGI_FIELD_H__ */
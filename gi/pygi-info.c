@@ -74,6 +74,10 @@ _base_info_dealloc (PyGIBaseInfo *self)
 
     g_base_info_unref(self->info);
 
+    if (self->plan != NULL) {
+        _pygi_invoke_plan_free(self->plan);
+    }
+
     self->ob_type->tp_free((PyObject *)self);
 }
 
@@ -425,7 +429,7 @@ _pygi_g_type_info_size (GITypeInfo *type_info)
                     if (g_type_info_is_pointer(type_info)) {
                         size = sizeof(gpointer);
                     } else {
-                        size = g_struct_info_get_size((GIStructInfo *)info);
+                        size = _pygi_struct_layout_get((GIStructInfo *)info)->size;
                     }
                     break;
                 case GI_INFO_TYPE_UNION:
@@ -487,788 +491,14 @@ _pygi_g_type_info_size (GITypeInfo *type_info)
 }
 
 
-static PyObject *
-_wrap_g_function_info_invoke (PyGIBaseInfo *self,
-                              PyObject     *py_args)
-{
-    gboolean is_method;
-    gboolean is_constructor;
-
-    gsize n_args;
-    gsize n_in_args;
-    gsize n_out_args;
-    gsize n_backup_args;
-    Py_ssize_t n_py_args;
-    gsize n_aux_in_args;
-    gsize n_aux_out_args;
-    gsize n_return_values;
-
-    guint8 callback_index;
-    guint8 user_data_index;
-    guint8 destroy_notify_index;
-    PyGICClosure *closure;
-
-    glong error_arg_pos;
-
-    GIArgInfo **arg_infos;
-    GITypeInfo **arg_type_infos;
-    GITypeInfo *return_type_info;
-    GITypeTag return_type_tag;
-
-    GArgument **args;
-    gboolean *args_is_auxiliary;
-
-    GArgument *in_args;
-    GArgument *out_args;
-    GArgument *out_values;
-    GArgument *backup_args;
-    GArgument return_arg;
-
-    PyObject *return_value = NULL;
-
-    gsize i;
-
-    {
-        GIFunctionInfoFlags flags;
-
-        flags = g_function_info_get_flags((GIFunctionInfo *)self->info);
-        is_method = (flags & GI_FUNCTION_IS_METHOD) != 0;
-        is_constructor = (flags & GI_FUNCTION_IS_CONSTRUCTOR) != 0;
-    }
-
-    /* Count arguments. */
-    n_args = g_callable_info_get_n_args((GICallableInfo *)self->info);
-    n_in_args = 0;
-    n_out_args = 0;
-    n_backup_args = 0;
-    n_aux_in_args = 0;
-    n_aux_out_args = 0;
-    
-    /* Check the argument count. */
-    n_py_args = PyTuple_Size(py_args);
-    g_assert(n_py_args >= 0);
-
-    error_arg_pos = -1;
-
-    arg_infos = g_newa(GIArgInfo *, n_args);
-    arg_type_infos = g_newa(GITypeInfo *, n_args);
-
-    args_is_auxiliary = g_newa(gboolean, n_args);
-    memset(args_is_auxiliary, 0, sizeof(args_is_auxiliary) * n_args);
-
-    if (!_pygi_scan_for_callbacks (self, is_method, &callback_index, &user_data_index,
-                             &destroy_notify_index))
-        return NULL;
-        
-    if (callback_index != G_MAXUINT8) {
-        if (!_pygi_create_callback (self, is_method, 
-                             n_args, n_py_args, py_args, callback_index,
-                             user_data_index,
-                             destroy_notify_index, &closure))
-            return NULL;
-
-        args_is_auxiliary[callback_index] = FALSE;
-        if (destroy_notify_index != G_MAXUINT8) {
-            args_is_auxiliary[destroy_notify_index] = TRUE;
-            n_aux_in_args += 1;
-        }
-    }
-
-    if (is_method) {
-        /* The first argument is the instance. */
-        n_in_args += 1;
-    }
-
-    /* We do a first (well, second) pass here over the function to scan for special cases.
-     * This is currently array+length combinations and GError.
-     */
-    for (i = 0; i < n_args; i++) {
-        GIDirection direction;
-        GITransfer transfer;
-        GITypeTag arg_type_tag;
-
-        arg_infos[i] = g_callable_info_get_arg((GICallableInfo *)self->info, i);
-        arg_type_infos[i] = g_arg_info_get_type(arg_infos[i]);
-        
-        direction = g_arg_info_get_direction(arg_infos[i]);
-        transfer = g_arg_info_get_ownership_transfer(arg_infos[i]);
-        arg_type_tag = g_type_info_get_tag(arg_type_infos[i]);
-
-        if (direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT) {
-            n_in_args += 1;
-            if (transfer == GI_TRANSFER_CONTAINER) {
-                n_backup_args += 1;
-            }
-        }
-        if (direction == GI_DIRECTION_OUT || direction == GI_DIRECTION_INOUT) {
-            n_out_args += 1;
-        }
-
-        if (direction == GI_DIRECTION_INOUT && transfer == GI_TRANSFER_NOTHING) {
-            n_backup_args += 1;
-        }
-
-        switch (arg_type_tag) {
-            case GI_TYPE_TAG_ARRAY:
-            {
-                gint length_arg_pos;
-
-                length_arg_pos = g_type_info_get_array_length(arg_type_infos[i]);
-
-                if (is_method)
-                    length_arg_pos--; // length_arg_pos refers to C args
-
-                if (length_arg_pos < 0) {
-                    break;
-                }
-
-                g_assert(length_arg_pos < n_args);
-                args_is_auxiliary[length_arg_pos] = TRUE;
-
-                if (direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT) {
-                    n_aux_in_args += 1;
-                }
-                if (direction == GI_DIRECTION_OUT || direction == GI_DIRECTION_INOUT) {
-                    n_aux_out_args += 1;
-                }
-
-                break;
-            }
-            case GI_TYPE_TAG_ERROR:
-                g_warn_if_fail(error_arg_pos < 0);
-                error_arg_pos = i;
-                break;
-            default:
-                break;
-        }
-    }
-
-    return_type_info = g_callable_info_get_return_type((GICallableInfo *)self->info);
-    return_type_tag = g_type_info_get_tag(return_type_info);
-
-    if (return_type_tag == GI_TYPE_TAG_ARRAY) {
-        gint length_arg_pos;
-        length_arg_pos = g_type_info_get_array_length(return_type_info);
-
-        if (is_method)
-            length_arg_pos--; // length_arg_pos refers to C args
-
-        if (length_arg_pos >= 0) {
-            g_assert(length_arg_pos < n_args);
-            args_is_auxiliary[length_arg_pos] = TRUE;
-            n_aux_out_args += 1;
-        }
-    }
-
-    n_return_values = n_out_args - n_aux_out_args;
-    if (return_type_tag != GI_TYPE_TAG_VOID) {
-        n_return_values += 1;
-    }
-
-    {
-        gsize n_py_args_expected;
-        Py_ssize_t py_args_pos;
-
-        n_py_args_expected = n_in_args
-            + (is_constructor ? 1 : 0)
-            - n_aux_in_args
-            - (error_arg_pos >= 0 ? 1 : 0);
-
-        if (n_py_args != n_py_args_expected) {
-            PyErr_Format(PyExc_TypeError,
-                "takes exactly %zd argument(s) (%zd given)",
-                n_py_args_expected, n_py_args);
-            goto out;
-        }
-
-        /* Check argument types. */
-        py_args_pos = 0;
-        if (is_constructor || is_method) {
-            py_args_pos += 1;
-        }
-
-        for (i = 0; i < n_args; i++) {
-            GIDirection direction;
-            GITypeTag type_tag;
-            PyObject *py_arg;
-            gint retval;
-
-            direction = g_arg_info_get_direction(arg_infos[i]);
-            type_tag = g_type_info_get_tag(arg_type_infos[i]);
-
-            if (direction == GI_DIRECTION_OUT
-                    || args_is_auxiliary[i]
-                    || type_tag == GI_TYPE_TAG_ERROR) {
-                continue;
-            }
-
-            g_assert(py_args_pos < n_py_args);
-            py_arg = PyTuple_GET_ITEM(py_args, py_args_pos);
-
-            retval = _pygi_g_type_info_check_object(arg_type_infos[i], py_arg);
-
-            if (retval < 0) {
-                goto out;
-            } else if (!retval) {
-                _PyGI_ERROR_PREFIX("argument %zd: ", py_args_pos);
-                goto out;
-            }
-
-            py_args_pos += 1;
-        }
-
-        g_assert(py_args_pos == n_py_args);
-    }
-
-    args = g_newa(GArgument *, n_args);
-    in_args = g_newa(GArgument, n_in_args);
-    out_args = g_newa(GArgument, n_out_args);
-    out_values = g_newa(GArgument, n_out_args);
-    backup_args = g_newa(GArgument, n_backup_args);
-
-    /* Bind args so we can use an unique index. */
-    {
-        gsize in_args_pos;
-        gsize out_args_pos;
-
-        in_args_pos = is_method ? 1 : 0;
-        out_args_pos = 0;
-
-        for (i = 0; i < n_args; i++) {
-            GIDirection direction;
-
-            direction = g_arg_info_get_direction(arg_infos[i]);
-
-            switch (direction) {
-                case GI_DIRECTION_IN:
-                    g_assert(in_args_pos < n_in_args);
-                    args[i] = &in_args[in_args_pos];
-                    in_args_pos += 1;
-                    break;
-                case GI_DIRECTION_INOUT:
-                    g_assert(in_args_pos < n_in_args);
-                    g_assert(out_args_pos < n_out_args);
-                    in_args[in_args_pos].v_pointer = &out_values[out_args_pos];
-                    in_args_pos += 1;
-                case GI_DIRECTION_OUT:
-                    g_assert(out_args_pos < n_out_args);
-                    out_args[out_args_pos].v_pointer = &out_values[out_args_pos];
-                    args[i] = &out_values[out_args_pos];
-                    out_args_pos += 1;
-            }
-        }
-
-        g_assert(in_args_pos == n_in_args);
-        g_assert(out_args_pos == n_out_args);
-    }
-
-    /* Convert the input arguments. */
-    {
-        Py_ssize_t py_args_pos;
-        gsize backup_args_pos;
-
-        py_args_pos = 0;
-        backup_args_pos = 0;
-
-        if (is_constructor) {
-            /* Skip the first argument. */
-            py_args_pos += 1;
-        } else if (is_method) {
-            /* Get the instance. */
-            GIBaseInfo *container_info;
-            GIInfoType container_info_type;
-            PyObject *py_arg;
-
-            container_info = g_base_info_get_container(self->info);
-            container_info_type = g_base_info_get_type(container_info);
-
-            g_assert(py_args_pos < n_py_args);
-            py_arg = PyTuple_GET_ITEM(py_args, py_args_pos);
-
-            switch(container_info_type) {
-                case GI_INFO_TYPE_UNION:
-                    PyErr_SetString(PyExc_NotImplementedError, "calling methods on unions is not supported yet.");
-                    goto out;
-                    break;
-                case GI_INFO_TYPE_STRUCT:
-                {
-                    GType type;
-
-                    type = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *)container_info);
-
-                    if (g_type_is_a(type, G_TYPE_BOXED)) {
-                        g_assert(n_in_args > 0);
-                        in_args[0].v_pointer = pyg_boxed_get(py_arg, void);
-                    } else if (g_type_is_a(type, G_TYPE_POINTER) || type == G_TYPE_NONE) {
-                        g_assert(n_in_args > 0);
-                        in_args[0].v_pointer = pyg_pointer_get(py_arg, void);
-                    } else {
-                        PyErr_Format(PyExc_TypeError, "unable to convert an instance of '%s'", g_type_name(type));
-                        goto out;
-                    }
-
-                    break;
-                }
-                case GI_INFO_TYPE_OBJECT:
-                case GI_INFO_TYPE_INTERFACE:
-                    g_assert(n_in_args > 0);
-                    in_args[0].v_pointer = pygobject_get(py_arg);
-                    break;
-                default:
-                    /* Other types don't have methods. */
-                    g_assert_not_reached();
-            }
-
-            py_args_pos += 1;
-        }
-
-        for (i = 0; i < n_args; i++) {
-            GIDirection direction;
-
-            if (i == callback_index) {
-                args[i]->v_pointer = closure->closure;
-                py_args_pos++;
-                continue;
-            } else if (i == user_data_index) {
-                args[i]->v_pointer = closure;
-                py_args_pos++;
-                continue;
-            } else if (i == destroy_notify_index) {
-                args[i]->v_pointer = _pygi_destroy_notify_create();
-                continue;
-            }
-            
-            if (args_is_auxiliary[i]) {
-                continue;
-            }
-
-            direction = g_arg_info_get_direction(arg_infos[i]);
-
-            if (direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT) {
-                PyObject *py_arg;
-                GITypeTag arg_type_tag;
-                GITransfer transfer;
-
-                arg_type_tag = g_type_info_get_tag(arg_type_infos[i]);
-
-                if (arg_type_tag == GI_TYPE_TAG_ERROR) {
-                    GError **error;
-
-                    error = g_slice_new(GError *);
-                    *error = NULL;
-
-                    args[i]->v_pointer = error;
-                    continue;
-                }
-
-                transfer = g_arg_info_get_ownership_transfer(arg_infos[i]);
-
-                g_assert(py_args_pos < n_py_args);
-                py_arg = PyTuple_GET_ITEM(py_args, py_args_pos);
-
-                *args[i] = _pygi_argument_from_object(py_arg, arg_type_infos[i], transfer);
-
-                if (PyErr_Occurred()) {
-                    /* TODO: release previous input arguments. */
-                    goto out;
-                }
-
-                if (direction == GI_DIRECTION_INOUT && transfer == GI_TRANSFER_NOTHING) {
-                    /* We need to keep a copy of the argument to be able to release it later. */
-                    g_assert(backup_args_pos < n_backup_args);
-                    backup_args[backup_args_pos] = *args[i];
-                    backup_args_pos += 1;
-                } else if (transfer == GI_TRANSFER_CONTAINER) {
-                    /* We need to keep a copy of the items to be able to release them later. */
-                    switch (arg_type_tag) {
-                        case GI_TYPE_TAG_ARRAY:
-                        {
-                            GArray *array;
-                            gsize item_size;
-                            GArray *new_array;
-
-                            array = args[i]->v_pointer;
-
-                            item_size = g_array_get_element_size(array);
-
-                            new_array = g_array_sized_new(FALSE, FALSE, item_size, array->len);
-                            g_array_append_vals(new_array, array->data, array->len);
-
-                            g_assert(backup_args_pos < n_backup_args);
-                            backup_args[backup_args_pos].v_pointer = new_array;
-
-                            break;
-                        }
-                        case GI_TYPE_TAG_GLIST:
-                            g_assert(backup_args_pos < n_backup_args);
-                            backup_args[backup_args_pos].v_pointer = g_list_copy(args[i]->v_pointer);
-                            break;
-                        case GI_TYPE_TAG_GSLIST:
-                            g_assert(backup_args_pos < n_backup_args);
-                            backup_args[backup_args_pos].v_pointer = g_slist_copy(args[i]->v_pointer);
-                            break;
-                        case GI_TYPE_TAG_GHASH:
-                        {
-                            GHashTable *hash_table;
-                            GList *keys;
-                            GList *values;
-
-                            hash_table = args[i]->v_pointer;
-
-                            keys = g_hash_table_get_keys(hash_table);
-                            values = g_hash_table_get_values(hash_table);
-
-                            g_assert(backup_args_pos < n_backup_args);
-                            backup_args[backup_args_pos].v_pointer = g_list_concat(keys, values);
-
-                            break;
-                        }
-                        default:
-                            g_warn_if_reached();
-                    }
-
-                    backup_args_pos += 1;
-                }
-
-                if (arg_type_tag == GI_TYPE_TAG_ARRAY) {
-                    GArray *array;
-                    gssize length_arg_pos;
-
-                    array = args[i]->v_pointer;
-
-                    length_arg_pos = g_type_info_get_array_length(arg_type_infos[i]);
-                    if (is_method)
-                        length_arg_pos--; // length_arg_pos refers to C args
-                    if (length_arg_pos >= 0) {
-                        /* Set the auxiliary argument holding the length. */
-                        args[length_arg_pos]->v_size = array->len;
-                    }
-
-                    /* Get rid of the GArray. */
-                    args[i]->v_pointer = array->data;
-
-                    if (direction != GI_DIRECTION_INOUT || transfer != GI_TRANSFER_NOTHING) {
-                        /* The array hasn't been referenced anywhere, so free it to avoid losing memory. */
-                        g_array_free(array, FALSE);
-                    }
-                }
-
-                py_args_pos += 1;
-            }
-        }
-
-        g_assert(py_args_pos == n_py_args);
-        g_assert(backup_args_pos == n_backup_args);
-    }
-
-    /* Invoke the callable. */
-    {
-        GError *error;
-        gint retval;
-
-        error = NULL;
-
-        retval = g_function_info_invoke((GIFunctionInfo *)self->info,
-                in_args, n_in_args, out_args, n_out_args, &return_arg, &error);
-        if (!retval) {
-            g_assert(error != NULL);
-            /* TODO: raise the right error, out of the error domain. */
-            PyErr_SetString(PyExc_RuntimeError, error->message);
-            g_error_free(error);
-
-            /* TODO: release input arguments. */
-
-            goto out;
-        }
-    }
-
-    if (error_arg_pos >= 0) {
-        GError **error;
-
-        error = args[error_arg_pos]->v_pointer;
-
-        if (*error != NULL) {
-            /* TODO: raise the right error, out of the error domain, if applicable. */
-            PyErr_SetString(PyExc_Exception, (*error)->message);
-            g_error_free(*error);
-
-            /* TODO: release input arguments. */
-
-            goto out;
-        }
-    }
-
-    /* Convert the return value. */
-    if (is_constructor) {
-        PyTypeObject *py_type;
-        GIBaseInfo *info;
-        GIInfoType info_type;
-        GITransfer transfer;
-
-        g_assert(n_py_args > 0);
-        py_type = (PyTypeObject *)PyTuple_GET_ITEM(py_args, 0);
-
-        info = g_type_info_get_interface(return_type_info);
-        g_assert(info != NULL);
-
-        info_type = g_base_info_get_type(info);
-
-        transfer = g_callable_info_get_caller_owns((GICallableInfo *)self->info);
-
-        switch (info_type) {
-            case GI_INFO_TYPE_UNION:
-                /* TODO */
-                PyErr_SetString(PyExc_NotImplementedError, "creating unions is not supported yet");
-                g_base_info_unref(info);
-                goto out;
-            case GI_INFO_TYPE_STRUCT:
-            {
-                GType type;
-
-                type = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *)info);
-
-                if (g_type_is_a(type, G_TYPE_BOXED)) {
-                    if (return_arg.v_pointer == NULL) {
-                        PyErr_SetString(PyExc_TypeError, "constructor returned NULL");
-                        break;
-                    }
-                    g_warn_if_fail(transfer == GI_TRANSFER_EVERYTHING);
-                    return_value = _pygi_boxed_new(py_type, return_arg.v_pointer, transfer == GI_TRANSFER_EVERYTHING);
-                } else if (g_type_is_a(type, G_TYPE_POINTER) || type == G_TYPE_NONE) {
-                    if (return_arg.v_pointer == NULL) {
-                        PyErr_SetString(PyExc_TypeError, "constructor returned NULL");
-                        break;
-                    }
-                    g_warn_if_fail(transfer == GI_TRANSFER_NOTHING);
-                    return_value = _pygi_struct_new(py_type, return_arg.v_pointer, transfer == GI_TRANSFER_EVERYTHING);
-                } else {
-                    PyErr_Format(PyExc_TypeError, "cannot create '%s' instances", py_type->tp_name);
-                    g_base_info_unref(info);
-                    goto out;
-                }
-
-                break;
-            }
-            case GI_INFO_TYPE_OBJECT:
-                if (return_arg.v_pointer == NULL) {
-                    PyErr_SetString(PyExc_TypeError, "constructor returned NULL");
-                    break;
-                }
-                return_value = pygobject_new(return_arg.v_pointer);
-                if (transfer == GI_TRANSFER_EVERYTHING) {
-                    /* The new wrapper increased the reference count, so decrease it. */
-                    g_object_unref (return_arg.v_pointer);
-                }
-                break;
-            default:
-                /* Other types don't have neither methods nor constructors. */
-                g_assert_not_reached();
-        }
-
-        g_base_info_unref(info);
-
-        if (return_value == NULL) {
-            /* TODO: release arguments. */
-            goto out;
-        }
-    } else {
-        GITransfer transfer;
-
-        if (return_type_tag == GI_TYPE_TAG_ARRAY) {
-            /* Create a #GArray. */
-            return_arg.v_pointer = _pygi_argument_to_array(&return_arg, args, return_type_info, is_method);
-        }
-
-        transfer = g_callable_info_get_caller_owns((GICallableInfo *)self->info);
-
-        return_value = _pygi_argument_to_object(&return_arg, return_type_info, transfer);
-        if (return_value == NULL) {
-            /* TODO: release argument. */
-            goto out;
-        }
-
-        _pygi_argument_release(&return_arg, return_type_info, transfer, GI_DIRECTION_OUT);
-
-        if (return_type_tag == GI_TYPE_TAG_ARRAY
-                && transfer == GI_TRANSFER_NOTHING) {
-            /* We created a #GArray, so free it. */
-            return_arg.v_pointer = g_array_free(return_arg.v_pointer, FALSE);
-        }
-    }
-
-    /* Convert output arguments and release arguments. */
-    {
-        gsize backup_args_pos;
-        gsize return_values_pos;
-
-        backup_args_pos = 0;
-        return_values_pos = 0;
-
-        if (n_return_values > 1) {
-            /* Return a tuple. */
-            PyObject *return_values;
-
-            return_values = PyTuple_New(n_return_values);
-            if (return_values == NULL) {
-                /* TODO: release arguments. */
-                goto out;
-            }
-
-            if (return_type_tag == GI_TYPE_TAG_VOID) {
-                /* The current return value is None. */
-                Py_DECREF(return_value);
-            } else {
-                /* Put the return value first. */
-                g_assert(return_value != NULL);
-                PyTuple_SET_ITEM(return_values, return_values_pos, return_value);
-                return_values_pos += 1;
-            }
-
-            return_value = return_values;
-        }
-
-        for (i = 0; i < n_args; i++) {
-            GIDirection direction;
-            GITypeTag type_tag;
-            GITransfer transfer;
-
-            if (args_is_auxiliary[i]) {
-                /* Auxiliary arguments are handled at the same time as their relatives. */
-                continue;
-            }
-
-            direction = g_arg_info_get_direction(arg_infos[i]);
-            transfer = g_arg_info_get_ownership_transfer(arg_infos[i]);
-
-            type_tag = g_type_info_get_tag(arg_type_infos[i]);
-
-            if (type_tag == GI_TYPE_TAG_ARRAY
-                    && (direction != GI_DIRECTION_IN || transfer == GI_TRANSFER_NOTHING)) {
-                /* Create a #GArray. */
-                args[i]->v_pointer = _pygi_argument_to_array(args[i], args, arg_type_infos[i], is_method);
-            }
-
-            if (direction == GI_DIRECTION_INOUT || direction == GI_DIRECTION_OUT) {
-                /* Convert the argument. */
-                PyObject *obj;
-
-                obj = _pygi_argument_to_object(args[i], arg_type_infos[i], transfer);
-                if (obj == NULL) {
-                    /* TODO: release arguments. */
-                    goto out;
-                }
-
-                g_assert(return_values_pos < n_return_values);
-
-                if (n_return_values > 1) {
-                    PyTuple_SET_ITEM(return_value, return_values_pos, obj);
-                } else {
-                    /* The current return value is None. */
-                    Py_DECREF(return_value);
-                    return_value = obj;
-                }
-
-                return_values_pos += 1;
-            }
-
-            /* Release the argument. */
-
-            if ((direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT)
-                    && transfer == GI_TRANSFER_CONTAINER) {
-                /* Release the items we kept in another container. */
-                switch (type_tag) {
-                    case GI_TYPE_TAG_ARRAY:
-                    case GI_TYPE_TAG_GLIST:
-                    case GI_TYPE_TAG_GSLIST:
-                        g_assert(backup_args_pos < n_backup_args);
-                        _pygi_argument_release(&backup_args[backup_args_pos], arg_type_infos[i],
-                            transfer, GI_DIRECTION_IN);
-                        break;
-                    case GI_TYPE_TAG_GHASH:
-                    {
-                        GITypeInfo *key_type_info;
-                        GITypeInfo *value_type_info;
-                        GList *item;
-                        gsize length;
-                        gsize j;
-
-                        key_type_info = g_type_info_get_param_type(arg_type_infos[i], 0);
-                        value_type_info = g_type_info_get_param_type(arg_type_infos[i], 1);
-
-                        g_assert(backup_args_pos < n_backup_args);
-                        item = backup_args[backup_args_pos].v_pointer;
-
-                        length = g_list_length(item) / 2;
-
-                        for (j = 0; j < length; j++, item = g_list_next(item)) {
-                            _pygi_argument_release((GArgument *)&item->data, key_type_info,
-                                GI_TRANSFER_NOTHING, GI_DIRECTION_IN);
-                        }
-
-                        for (j = 0; j < length; j++, item = g_list_next(item)) {
-                            _pygi_argument_release((GArgument *)&item->data, value_type_info,
-                                GI_TRANSFER_NOTHING, GI_DIRECTION_IN);
-                        }
-
-                        g_list_free(backup_args[backup_args_pos].v_pointer);
-
-                        break;
-                    }
-                    default:
-                        g_warn_if_reached();
-                }
-
-                if (direction == GI_DIRECTION_INOUT) {
-                    /* Release the output argument. */
-                    _pygi_argument_release(args[i], arg_type_infos[i], GI_TRANSFER_CONTAINER,
-                        GI_DIRECTION_OUT);
-                }
-
-                backup_args_pos += 1;
-            } else if (direction == GI_DIRECTION_INOUT) {
-                if (transfer == GI_TRANSFER_NOTHING) {
-                    g_assert(backup_args_pos < n_backup_args);
-                    _pygi_argument_release(&backup_args[backup_args_pos], arg_type_infos[i],
-                        GI_TRANSFER_NOTHING, GI_DIRECTION_IN);
-                    backup_args_pos += 1;
-                }
-
-                _pygi_argument_release(args[i], arg_type_infos[i], transfer,
-                    GI_DIRECTION_OUT);
-            } else {
-                _pygi_argument_release(args[i], arg_type_infos[i], transfer, direction);
-            }
-
-            if (type_tag == GI_TYPE_TAG_ARRAY
-                    && (direction != GI_DIRECTION_IN && transfer == GI_TRANSFER_NOTHING)) {
-                /* We created a #GArray and it has not been released above, so free it. */
-                args[i]->v_pointer = g_array_free(args[i]->v_pointer, FALSE);
-            }
-        }
-
-        g_assert(n_return_values <= 1 || return_values_pos == n_return_values);
-        g_assert(backup_args_pos == n_backup_args);
-    }
-
-out:
-    g_base_info_unref((GIBaseInfo *)return_type_info);
-
-    for (i = 0; i < n_args; i++) {
-        g_base_info_unref((GIBaseInfo *)arg_type_infos[i]);
-        g_base_info_unref((GIBaseInfo *)arg_infos[i]);
-    }
-
-    if (PyErr_Occurred()) {
-        Py_CLEAR(return_value);
-    }
-
-    return return_value;
-}
-
 static PyMethodDef _PyGIFunctionInfo_methods[] = {
     { "is_constructor", (PyCFunction)_wrap_g_function_info_is_constructor, METH_NOARGS },
     { "is_method", (PyCFunction)_wrap_g_function_info_is_method, METH_NOARGS },
     { "invoke", (PyCFunction)_wrap_g_function_info_invoke, METH_VARARGS },
+    { "invoke_many", (PyCFunction)_wrap_g_function_info_invoke_many, METH_VARARGS | METH_KEYWORDS },
+    { "prepare", (PyCFunction)_wrap_g_function_info_prepare, METH_NOARGS },
+    { "invoke_future", (PyCFunction)_wrap_g_function_info_invoke_future, METH_VARARGS },
+    { "invoke_async", (PyCFunction)_wrap_g_function_info_invoke_async, METH_VARARGS },
     { NULL, NULL, 0 }
 };
 
@@ -1376,118 +606,7 @@ static PyMethodDef _PyGIStructInfo_methods[] = {
 gboolean
 pygi_g_struct_info_is_simple (GIStructInfo *struct_info)
 {
-    gboolean is_simple;
-    gsize n_field_infos;
-    gsize i;
-
-    is_simple = TRUE;
-
-    n_field_infos = g_struct_info_get_n_fields(struct_info);
-
-    for (i = 0; i < n_field_infos && is_simple; i++) {
-        GIFieldInfo *field_info;
-        GITypeInfo *field_type_info;
-
-        field_info = g_struct_info_get_field(struct_info, i);
-        field_type_info = g_field_info_get_type(field_info);
-
-        GITypeTag field_type_tag;
-
-        field_type_tag = g_type_info_get_tag(field_type_info);
-
-        switch (field_type_tag) {
-            case GI_TYPE_TAG_BOOLEAN:
-            case GI_TYPE_TAG_INT8:
-            case GI_TYPE_TAG_UINT8:
-            case GI_TYPE_TAG_INT16:
-            case GI_TYPE_TAG_UINT16:
-            case GI_TYPE_TAG_INT32:
-            case GI_TYPE_TAG_UINT32:
-            case GI_TYPE_TAG_SHORT:
-            case GI_TYPE_TAG_USHORT:
-            case GI_TYPE_TAG_INT:
-            case GI_TYPE_TAG_UINT:
-            case GI_TYPE_TAG_INT64:
-            case GI_TYPE_TAG_UINT64:
-            case GI_TYPE_TAG_LONG:
-            case GI_TYPE_TAG_ULONG:
-            case GI_TYPE_TAG_SSIZE:
-            case GI_TYPE_TAG_SIZE:
-            case GI_TYPE_TAG_FLOAT:
-            case GI_TYPE_TAG_DOUBLE:
-            case GI_TYPE_TAG_TIME_T:
-                if (g_type_info_is_pointer(field_type_info)) {
-                    is_simple = FALSE;
-                }
-                break;
-            case GI_TYPE_TAG_VOID:
-            case GI_TYPE_TAG_GTYPE:
-            case GI_TYPE_TAG_ERROR:
-            case GI_TYPE_TAG_UTF8:
-            case GI_TYPE_TAG_FILENAME:
-            case GI_TYPE_TAG_ARRAY:
-            case GI_TYPE_TAG_GLIST:
-            case GI_TYPE_TAG_GSLIST:
-            case GI_TYPE_TAG_GHASH:
-                is_simple = FALSE;
-                break;
-            case GI_TYPE_TAG_INTERFACE:
-            {
-                GIBaseInfo *info;
-                GIInfoType info_type;
-
-                info = g_type_info_get_interface(field_type_info);
-                info_type = g_base_info_get_type(info);
-
-                switch (info_type) {
-                    case GI_INFO_TYPE_STRUCT:
-                        if (g_type_info_is_pointer(field_type_info)) {
-                            is_simple = FALSE;
-                        } else {
-                            is_simple = pygi_g_struct_info_is_simple((GIStructInfo *)info);
-                        }
-                        break;
-                    case GI_INFO_TYPE_UNION:
-                        /* TODO */
-                        is_simple = FALSE;
-                        break;
-                    case GI_INFO_TYPE_ENUM:
-                    case GI_INFO_TYPE_FLAGS:
-                        if (g_type_info_is_pointer(field_type_info)) {
-                            is_simple = FALSE;
-                        }
-                        break;
-                    case GI_INFO_TYPE_BOXED:
-                    case GI_INFO_TYPE_OBJECT:
-                    case GI_INFO_TYPE_CALLBACK:
-                    case GI_INFO_TYPE_INTERFACE:
-                        is_simple = FALSE;
-                        break;
-                    case GI_INFO_TYPE_VFUNC:
-                    case GI_INFO_TYPE_INVALID:
-                    case GI_INFO_TYPE_FUNCTION:
-                    case GI_INFO_TYPE_CONSTANT:
-                    case GI_INFO_TYPE_ERROR_DOMAIN:
-                    case GI_INFO_TYPE_VALUE:
-                    case GI_INFO_TYPE_SIGNAL:
-                    case GI_INFO_TYPE_PROPERTY:
-                    case GI_INFO_TYPE_FIELD:
-                    case GI_INFO_TYPE_ARG:
-                    case GI_INFO_TYPE_TYPE:
-                    case GI_INFO_TYPE_UNRESOLVED:
-                        g_assert_not_reached();
-                }
-
-                g_base_info_unref(info);
-                break;
-            }
-        }
-
-        g_base_info_unref((GIBaseInfo *)field_type_info);
-        g_base_info_unref((GIBaseInfo *)field_info);
-    }
-
-    return is_simple;
+    return _pygi_struct_layout_get(struct_info)->is_simple;
 }
 
 
@@ -1845,23 +964,15 @@ static PyMethodDef _PyGIValueInfo_methods[] = {
 /* GIFieldInfo */
 _PyGI_DEFINE_INFO_TYPE("FieldInfo", GIFieldInfo, PyGIBaseInfo_Type);
 
-static PyObject *
-_wrap_g_field_info_get_value (PyGIBaseInfo *self,
-                              PyObject     *args)
+static gpointer
+_pygi_g_field_info_get_instance_pointer (GIFieldInfo *field_info,
+                                         PyObject    *instance)
 {
-    PyObject *instance;
     GIBaseInfo *container_info;
     GIInfoType container_info_type;
-    gpointer pointer;
-    GITypeInfo *field_type_info;
-    GArgument value;
-    PyObject *py_value = NULL;
-
-    if (!PyArg_ParseTuple(args, "O:FieldInfo.get_value", &instance)) {
-        return NULL;
-    }
+    gpointer pointer = NULL;
 
-    container_info = g_base_info_get_container(self->info);
+    container_info = g_base_info_get_container((GIBaseInfo *)field_info);
     g_assert(container_info != NULL);
 
     /* Check the instance. */
@@ -1874,7 +985,7 @@ _wrap_g_field_info_get_value (PyGIBaseInfo *self,
     container_info_type = g_base_info_get_type(container_info);
     switch (container_info_type) {
         case GI_INFO_TYPE_UNION:
-            PyErr_SetString(PyExc_NotImplementedError, "getting a field from an union is not supported yet");
+            PyErr_SetString(PyExc_NotImplementedError, "accessing a field of an union is not supported yet");
             return NULL;
         case GI_INFO_TYPE_STRUCT:
             pointer = pyg_boxed_get(instance, void);
@@ -1887,8 +998,20 @@ _wrap_g_field_info_get_value (PyGIBaseInfo *self,
             g_assert_not_reached();
     }
 
+    return pointer;
+}
+
+PyObject *
+_pygi_g_field_info_get_value (GIFieldInfo *field_info,
+                              PyObject    *instance,
+                              gpointer     pointer)
+{
+    GITypeInfo *field_type_info;
+    GArgument value;
+    PyObject *py_value = NULL;
+
     /* Get the field's value. */
-    field_type_info = g_field_info_get_type((GIFieldInfo *)self->info);
+    field_type_info = g_field_info_get_type(field_info);
 
     /* A few types are not handled by g_field_info_get_field, so do it here. */
     if (!g_type_info_is_pointer(field_type_info)
@@ -1896,7 +1019,7 @@ _wrap_g_field_info_get_value (PyGIBaseInfo *self,
         GIBaseInfo *info;
         GIInfoType info_type;
 
-        if (!(g_field_info_get_flags((GIFieldInfo *)self->info) & GI_FIELD_IS_READABLE)) {
+        if (!(g_field_info_get_flags(field_info) & GI_FIELD_IS_READABLE)) {
             PyErr_SetString(PyExc_RuntimeError, "field is not readable");
             goto out;
         }
@@ -1915,11 +1038,18 @@ _wrap_g_field_info_get_value (PyGIBaseInfo *self,
             {
                 gsize offset;
 
-                offset = g_field_info_get_offset((GIFieldInfo *)self->info);
+                offset = g_field_info_get_offset(field_info);
 
                 value.v_pointer = pointer + offset;
 
-                goto argument_to_object;
+                py_value = _pygi_argument_to_object(&value, field_type_info, GI_TRANSFER_NOTHING);
+
+                /* The wrapper is a view on the instance's memory. */
+                if (py_value != NULL) {
+                    _pygi_struct_set_parent(py_value, instance);
+                }
+
+                goto out;
             }
             default:
                 /* Fallback. */
@@ -1927,12 +1057,11 @@ _wrap_g_field_info_get_value (PyGIBaseInfo *self,
         }
     }
 
-    if (!g_field_info_get_field((GIFieldInfo *)self->info, pointer, &value)) {
+    if (!g_field_info_get_field(field_info, pointer, &value)) {
         PyErr_SetString(PyExc_RuntimeError, "unable to get the value");
         goto out;
     }
 
-argument_to_object:
     py_value = _pygi_argument_to_object(&value, field_type_info, GI_TRANSFER_NOTHING);
 
 out:
@@ -1941,65 +1070,17 @@ out:
     return py_value;
 }
 
-static PyObject *
-_wrap_g_field_info_set_value (PyGIBaseInfo *self,
-                              PyObject     *args)
+/* The value must have been checked with _pygi_g_type_info_check_object(). */
+gint
+_pygi_g_field_info_set_value (GIFieldInfo *field_info,
+                              gpointer     pointer,
+                              PyObject    *py_value)
 {
-    PyObject *instance;
-    PyObject *py_value;
-    GIBaseInfo *container_info;
-    GIInfoType container_info_type;
-    gpointer pointer;
     GITypeInfo *field_type_info;
     GArgument value;
-    PyObject *retval = NULL;
-
-    if (!PyArg_ParseTuple(args, "OO:FieldInfo.set_value", &instance, &py_value)) {
-        return NULL;
-    }
-
-    container_info = g_base_info_get_container(self->info);
-    g_assert(container_info != NULL);
-
-    /* Check the instance. */
-    if (!_pygi_g_registered_type_info_check_object((GIRegisteredTypeInfo *)container_info, TRUE, instance)) {
-        _PyGI_ERROR_PREFIX("argument 1: ");
-        return NULL;
-    }
-
-    /* Get the pointer to the container. */
-    container_info_type = g_base_info_get_type(container_info);
-    switch (container_info_type) {
-        case GI_INFO_TYPE_UNION:
-            PyErr_SetString(PyExc_NotImplementedError, "setting a field in an union is not supported yet");
-            return NULL;
-        case GI_INFO_TYPE_STRUCT:
-            pointer = pyg_boxed_get(instance, void);
-            break;
-        case GI_INFO_TYPE_OBJECT:
-            pointer = pygobject_get(instance);
-            break;
-        default:
-            /* Other types don't have fields. */
-            g_assert_not_reached();
-    }
-
-    field_type_info = g_field_info_get_type((GIFieldInfo *)self->info);
-
-    /* Check the value. */
-    {
-        gboolean retval;
+    gint retval = -1;
 
-        retval = _pygi_g_type_info_check_object(field_type_info, py_value);
-        if (retval < 0) {
-            goto out;
-        }
-
-        if (!retval) {
-            _PyGI_ERROR_PREFIX("argument 2: ");
-            goto out;
-        }
-    }
+    field_type_info = g_field_info_get_type(field_info);
 
     /* Set the field's value. */
     /* A few types are not handled by g_field_info_set_field, so do it here. */
@@ -2008,7 +1089,7 @@ _wrap_g_field_info_set_value (PyGIBaseInfo *self,
         GIBaseInfo *info;
         GIInfoType info_type;
 
-        if (!(g_field_info_get_flags((GIFieldInfo *)self->info) & GI_FIELD_IS_WRITABLE)) {
+        if (!(g_field_info_get_flags(field_info) & GI_FIELD_IS_WRITABLE)) {
             PyErr_SetString(PyExc_RuntimeError, "field is not writable");
             goto out;
         }
@@ -2020,16 +1101,16 @@ _wrap_g_field_info_set_value (PyGIBaseInfo *self,
         switch (info_type) {
             case GI_INFO_TYPE_UNION:
                 PyErr_SetString(PyExc_NotImplementedError, "setting an union is not supported yet");
+                g_base_info_unref(info);
                 goto out;
             case GI_INFO_TYPE_STRUCT:
             {
-                gboolean is_simple;
+                PyGIStructLayout *layout;
                 gsize offset;
-                gssize size;
 
-                is_simple = pygi_g_struct_info_is_simple((GIStructInfo *)info);
+                layout = _pygi_struct_layout_get((GIStructInfo *)info);
 
-                if (!is_simple) {
+                if (!layout->is_simple) {
                     PyErr_SetString(PyExc_TypeError,
                             "cannot set a structure which has no well-defined ownership transfer rules");
                     g_base_info_unref(info);
@@ -2042,15 +1123,14 @@ _wrap_g_field_info_set_value (PyGIBaseInfo *self,
                     goto out;
                 }
 
-                offset = g_field_info_get_offset((GIFieldInfo *)self->info);
-                size = g_struct_info_get_size((GIStructInfo *)info);
-                g_assert(size > 0);
+                offset = g_field_info_get_offset(field_info);
+                g_assert(layout->size > 0);
 
-                g_memmove(pointer + offset, value.v_pointer, size);
+                g_memmove(pointer + offset, value.v_pointer, layout->size);
 
                 g_base_info_unref(info);
 
-                retval = Py_None;
+                retval = 0;
                 goto out;
             }
             default:
@@ -2066,21 +1146,78 @@ _wrap_g_field_info_set_value (PyGIBaseInfo *self,
         goto out;
     }
 
-    if (!g_field_info_set_field((GIFieldInfo *)self->info, pointer, &value)) {
+    if (!g_field_info_set_field(field_info, pointer, &value)) {
         _pygi_argument_release(&value, field_type_info, GI_TRANSFER_NOTHING, GI_DIRECTION_IN);
         PyErr_SetString(PyExc_RuntimeError, "unable to set value for field");
         goto out;
     }
 
-    retval = Py_None;
+    retval = 0;
 
 out:
     g_base_info_unref((GIBaseInfo *)field_type_info);
 
-    Py_XINCREF(retval);
     return retval;
 }
 
+static PyObject *
+_wrap_g_field_info_get_value (PyGIBaseInfo *self,
+                              PyObject     *args)
+{
+    PyObject *instance;
+    gpointer pointer;
+
+    if (!PyArg_ParseTuple(args, "O:FieldInfo.get_value", &instance)) {
+        return NULL;
+    }
+
+    pointer = _pygi_g_field_info_get_instance_pointer((GIFieldInfo *)self->info, instance);
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+
+    return _pygi_g_field_info_get_value((GIFieldInfo *)self->info, instance, pointer);
+}
+
+static PyObject *
+_wrap_g_field_info_set_value (PyGIBaseInfo *self,
+                              PyObject     *args)
+{
+    PyObject *instance;
+    PyObject *py_value;
+    gpointer pointer;
+    GITypeInfo *field_type_info;
+    gint retval;
+
+    if (!PyArg_ParseTuple(args, "OO:FieldInfo.set_value", &instance, &py_value)) {
+        return NULL;
+    }
+
+    pointer = _pygi_g_field_info_get_instance_pointer((GIFieldInfo *)self->info, instance);
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+
+    /* Check the value. */
+    field_type_info = g_field_info_get_type((GIFieldInfo *)self->info);
+    retval = _pygi_g_type_info_check_object(field_type_info, py_value);
+    g_base_info_unref((GIBaseInfo *)field_type_info);
+
+    if (retval < 0) {
+        return NULL;
+    }
+    if (!retval) {
+        _PyGI_ERROR_PREFIX("argument 2: ");
+        return NULL;
+    }
+
+    if (_pygi_g_field_info_set_value((GIFieldInfo *)self->info, pointer, py_value) < 0) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
 static PyMethodDef _PyGIFieldInfo_methods[] = {
     { "get_value", (PyCFunction)_wrap_g_field_info_get_value, METH_VARARGS },
     { "set_value", (PyCFunction)_wrap_g_field_info_set_value, METH_VARARGS },
@@ -2122,6 +1259,24 @@ _pygi_g_base_info_get_fullname (GIBaseInfo *info)
     return fullname;
 }
 
+/* Like _pygi_g_base_info_get_fullname(), but callbacks found in the
+ * arguments of other callables are not qualified by them.  Doesn't need
+ * the GIL. */
+gchar *
+_pygi_g_callable_info_get_qualified_name (GICallableInfo *info)
+{
+    GIBaseInfo *container;
+
+    container = g_base_info_get_container((GIBaseInfo *)info);
+    if (container != NULL && g_base_info_get_type((GIBaseInfo *)info) == GI_INFO_TYPE_FUNCTION) {
+        return g_strdup_printf("%s.%s.%s", g_base_info_get_namespace((GIBaseInfo *)info),
+                g_base_info_get_name(container), g_base_info_get_name((GIBaseInfo *)info));
+    }
+
+    return g_strdup_printf("%s.%s", g_base_info_get_namespace((GIBaseInfo *)info),
+            g_base_info_get_name((GIBaseInfo *)info));
+}
+
 void
 _pygi_info_register_types (PyObject *m)
 {
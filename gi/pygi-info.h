@@ -53,6 +53,14 @@ GIBaseInfo* _pygi_object_get_gi_info (PyObject     *object,
                                       PyTypeObject *type);
 
 gchar* _pygi_g_base_info_get_fullname (GIBaseInfo *info);
+gchar* _pygi_g_callable_info_get_qualified_name (GICallableInfo *info);
+
+PyObject *_pygi_g_field_info_get_value (GIFieldInfo *field_info,
+                                         PyObject    *instance,
+                                         gpointer     pointer);
+gint _pygi_g_field_info_set_value (GIFieldInfo *field_info,
+                                   gpointer     pointer,
+                                   PyObject    *py_value);
 
 gsize _pygi_g_type_tag_size (GITypeTag type_tag);
 gsize _pygi_g_type_info_size (GITypeInfo *type_info);
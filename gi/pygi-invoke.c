@@ -0,0 +1,1253 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ * Copyright (C) 2005-2009 Johan Dahlin <johan@gnome.org>
+ *
+ *   pygi-invoke.c: FunctionInfo invocation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+#include <pygobject.h>
+
+static PyGIInvokePlan *
+_pygi_invoke_plan_new (PyGIBaseInfo *self)
+{
+    PyGIInvokePlan *plan;
+    gsize i;
+
+    plan = g_slice_new0(PyGIInvokePlan);
+
+    plan->info = (GIFunctionInfo *)g_base_info_ref(self->info);
+    plan->name = _pygi_g_callable_info_get_qualified_name((GICallableInfo *)plan->info);
+
+    {
+        GIFunctionInfoFlags flags;
+
+        flags = g_function_info_get_flags(plan->info);
+        plan->is_method = (flags & GI_FUNCTION_IS_METHOD) != 0;
+        plan->is_constructor = (flags & GI_FUNCTION_IS_CONSTRUCTOR) != 0;
+    }
+
+    /* Count arguments. */
+    plan->n_args = g_callable_info_get_n_args((GICallableInfo *)plan->info);
+    plan->error_arg_pos = -1;
+
+    plan->args = g_new0(PyGIArgPlan, plan->n_args);
+
+    for (i = 0; i < plan->n_args; i++) {
+        plan->args[i].arg_info = g_callable_info_get_arg((GICallableInfo *)plan->info, i);
+        plan->args[i].type_info = g_arg_info_get_type(plan->args[i].arg_info);
+        plan->args[i].direction = g_arg_info_get_direction(plan->args[i].arg_info);
+        plan->args[i].transfer = g_arg_info_get_ownership_transfer(plan->args[i].arg_info);
+        plan->args[i].type_tag = g_type_info_get_tag(plan->args[i].type_info);
+        plan->args[i].length_arg_pos = -1;
+    }
+
+    plan->return_type_info = g_callable_info_get_return_type((GICallableInfo *)plan->info);
+    plan->return_type_tag = g_type_info_get_tag(plan->return_type_info);
+    plan->return_transfer = g_callable_info_get_caller_owns((GICallableInfo *)plan->info);
+
+    if (!_pygi_scan_for_callbacks (self, plan->is_method, &plan->callback_index,
+                                   &plan->user_data_index, &plan->destroy_notify_index)) {
+        _pygi_invoke_plan_free(plan);
+        return NULL;
+    }
+
+    if (plan->callback_index != G_MAXUINT8) {
+        plan->args[plan->callback_index].is_auxiliary = FALSE;
+        if (plan->destroy_notify_index != G_MAXUINT8) {
+            plan->args[plan->destroy_notify_index].is_auxiliary = TRUE;
+            plan->n_aux_in_args += 1;
+        }
+    }
+
+    if (plan->is_method) {
+        /* The first argument is the instance. */
+        plan->n_in_args += 1;
+    }
+
+    /* We do a first (well, second) pass here over the function to scan for special cases.
+     * This is currently array+length combinations and GError.
+     */
+    for (i = 0; i < plan->n_args; i++) {
+        PyGIArgPlan *arg = &plan->args[i];
+
+        if (arg->direction == GI_DIRECTION_IN || arg->direction == GI_DIRECTION_INOUT) {
+            plan->n_in_args += 1;
+            if (arg->transfer == GI_TRANSFER_CONTAINER) {
+                plan->n_backup_args += 1;
+            }
+        }
+        if (arg->direction == GI_DIRECTION_OUT || arg->direction == GI_DIRECTION_INOUT) {
+            plan->n_out_args += 1;
+        }
+
+        if (arg->direction == GI_DIRECTION_INOUT && arg->transfer == GI_TRANSFER_NOTHING) {
+            plan->n_backup_args += 1;
+        }
+
+        switch (arg->type_tag) {
+            case GI_TYPE_TAG_ARRAY:
+            {
+                gint length_arg_pos;
+
+                length_arg_pos = g_type_info_get_array_length(arg->type_info);
+
+                if (plan->is_method)
+                    length_arg_pos--; // length_arg_pos refers to C args
+
+                if (length_arg_pos < 0) {
+                    break;
+                }
+
+                g_assert(length_arg_pos < plan->n_args);
+                plan->args[length_arg_pos].is_auxiliary = TRUE;
+                arg->length_arg_pos = length_arg_pos;
+
+                if (arg->direction == GI_DIRECTION_IN || arg->direction == GI_DIRECTION_INOUT) {
+                    plan->n_aux_in_args += 1;
+                }
+                if (arg->direction == GI_DIRECTION_OUT || arg->direction == GI_DIRECTION_INOUT) {
+                    plan->n_aux_out_args += 1;
+                }
+
+                break;
+            }
+            case GI_TYPE_TAG_ERROR:
+                g_warn_if_fail(plan->error_arg_pos < 0);
+                plan->error_arg_pos = i;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (plan->return_type_tag == GI_TYPE_TAG_ARRAY) {
+        gint length_arg_pos;
+        length_arg_pos = g_type_info_get_array_length(plan->return_type_info);
+
+        if (plan->is_method)
+            length_arg_pos--; // length_arg_pos refers to C args
+
+        if (length_arg_pos >= 0) {
+            g_assert(length_arg_pos < plan->n_args);
+            plan->args[length_arg_pos].is_auxiliary = TRUE;
+            plan->n_aux_out_args += 1;
+        }
+    }
+
+    plan->n_return_values = plan->n_out_args - plan->n_aux_out_args;
+    if (plan->return_type_tag != GI_TYPE_TAG_VOID) {
+        plan->n_return_values += 1;
+    }
+
+    plan->n_py_args = plan->n_in_args
+        + (plan->is_constructor ? 1 : 0)
+        - plan->n_aux_in_args
+        - (plan->error_arg_pos >= 0 ? 1 : 0);
+
+    /* Map the callback and user data to the Python arguments, which skip
+     * the auxiliary and output arguments. */
+    plan->callback_py_pos = -1;
+    plan->user_data_py_pos = -1;
+    {
+        Py_ssize_t py_args_pos;
+
+        py_args_pos = plan->is_constructor || plan->is_method ? 1 : 0;
+
+        for (i = 0; i < plan->n_args; i++) {
+            if (plan->args[i].direction == GI_DIRECTION_OUT
+                    || plan->args[i].is_auxiliary
+                    || plan->args[i].type_tag == GI_TYPE_TAG_ERROR) {
+                continue;
+            }
+
+            if (i == plan->callback_index) {
+                plan->callback_py_pos = py_args_pos;
+            } else if (i == plan->user_data_index) {
+                plan->user_data_py_pos = py_args_pos;
+            }
+
+            py_args_pos += 1;
+        }
+    }
+
+    plan->state_size = (plan->n_in_args + 2 * plan->n_out_args + plan->n_backup_args) * sizeof(GArgument)
+        + plan->n_args * sizeof(GArgument *);
+
+    return plan;
+}
+
+void
+_pygi_invoke_plan_free (PyGIInvokePlan *plan)
+{
+    gsize i;
+
+    for (i = 0; i < plan->n_args; i++) {
+        g_base_info_unref((GIBaseInfo *)plan->args[i].type_info);
+        g_base_info_unref((GIBaseInfo *)plan->args[i].arg_info);
+    }
+    g_free(plan->args);
+
+    if (plan->return_type_info != NULL) {
+        g_base_info_unref((GIBaseInfo *)plan->return_type_info);
+    }
+
+    g_base_info_unref((GIBaseInfo *)plan->info);
+    g_free(plan->name);
+
+    Py_XDECREF(plan->py_finish_info);
+
+    g_slice_free(PyGIInvokePlan, plan);
+}
+
+PyGIInvokePlan *
+_pygi_invoke_plan_get (PyGIBaseInfo *self)
+{
+    if (G_UNLIKELY(self->plan == NULL)) {
+        self->plan = _pygi_invoke_plan_new(self);
+    }
+
+    return self->plan;
+}
+
+void
+_pygi_invoke_state_init (PyGIInvokeState *state,
+                         PyGIInvokePlan  *plan,
+                         gpointer         storage)
+{
+    GArgument *arguments;
+    gsize i;
+
+    state->plan = plan;
+    state->closure = NULL;
+    state->native_callback = NULL;
+    state->error = NULL;
+    state->stats_start = 0;
+
+    /* The GArgument arrays come first so that they are suitably aligned. */
+    arguments = storage;
+    state->in_args = arguments;
+    state->out_args = state->in_args + plan->n_in_args;
+    state->out_values = state->out_args + plan->n_out_args;
+    state->backup_args = state->out_values + plan->n_out_args;
+    state->args = (GArgument **)(state->backup_args + plan->n_backup_args);
+
+    /* Bind args so we can use an unique index. */
+    {
+        gsize in_args_pos;
+        gsize out_args_pos;
+
+        in_args_pos = plan->is_method ? 1 : 0;
+        out_args_pos = 0;
+
+        for (i = 0; i < plan->n_args; i++) {
+            switch (plan->args[i].direction) {
+                case GI_DIRECTION_IN:
+                    g_assert(in_args_pos < plan->n_in_args);
+                    state->args[i] = &state->in_args[in_args_pos];
+                    in_args_pos += 1;
+                    break;
+                case GI_DIRECTION_INOUT:
+                    g_assert(in_args_pos < plan->n_in_args);
+                    g_assert(out_args_pos < plan->n_out_args);
+                    state->in_args[in_args_pos].v_pointer = &state->out_values[out_args_pos];
+                    in_args_pos += 1;
+                case GI_DIRECTION_OUT:
+                    g_assert(out_args_pos < plan->n_out_args);
+                    state->out_args[out_args_pos].v_pointer = &state->out_values[out_args_pos];
+                    state->args[i] = &state->out_values[out_args_pos];
+                    out_args_pos += 1;
+            }
+        }
+
+        g_assert(in_args_pos == plan->n_in_args);
+        g_assert(out_args_pos == plan->n_out_args);
+    }
+}
+
+/* Record the statistics of an invocation, which failed unless it went
+ * through _pygi_invoke_process(). */
+static void
+_pygi_invoke_stats_record (PyGIInvokeState *state,
+                           gboolean         failed)
+{
+    PyGIInvokePlan *plan = state->plan;
+
+    if (plan->stats == NULL) {
+        plan->stats = _pygi_stats_get((GIBaseInfo *)plan->info);
+    }
+    _pygi_stats_record(plan->stats, state->stats_times, failed);
+}
+
+static gboolean
+_pygi_invoke_prepare_args (PyGIBaseInfo    *self,
+                           PyGIInvokeState *state,
+                           PyObject        *py_args)
+{
+    PyGIInvokePlan *plan = state->plan;
+    Py_ssize_t n_py_args;
+    gsize i;
+
+    /* Check the argument count. */
+    n_py_args = PyTuple_Size(py_args);
+    g_assert(n_py_args >= 0);
+
+    if (n_py_args != plan->n_py_args) {
+        PyErr_Format(PyExc_TypeError,
+            "takes exactly %zd argument(s) (%zd given)",
+            plan->n_py_args, n_py_args);
+        return FALSE;
+    }
+
+    /* Check argument types. */
+    {
+        Py_ssize_t py_args_pos;
+
+        py_args_pos = 0;
+        if (plan->is_constructor || plan->is_method) {
+            py_args_pos += 1;
+        }
+
+        for (i = 0; i < plan->n_args; i++) {
+            PyObject *py_arg;
+            gint retval;
+
+            if (plan->args[i].direction == GI_DIRECTION_OUT
+                    || plan->args[i].is_auxiliary
+                    || plan->args[i].type_tag == GI_TYPE_TAG_ERROR) {
+                continue;
+            }
+
+            g_assert(py_args_pos < n_py_args);
+            py_arg = PyTuple_GET_ITEM(py_args, py_args_pos);
+
+            if (_pygi_steal_check(py_arg)) {
+                if (!_pygi_steal_check_type_info(plan->args[i].type_info, plan->args[i].transfer)) {
+                    PyErr_Format(PyExc_TypeError,
+                            "argument %zd: only boxed arguments given to the callee can be stolen",
+                            py_args_pos);
+                    return FALSE;
+                }
+                py_arg = ((PyGISteal *)py_arg)->object;
+            }
+
+            retval = _pygi_g_type_info_check_object(plan->args[i].type_info, py_arg);
+
+            if (retval < 0) {
+                return FALSE;
+            } else if (!retval) {
+                _PyGI_ERROR_PREFIX("argument %zd: ", py_args_pos);
+                return FALSE;
+            }
+
+            py_args_pos += 1;
+        }
+
+        g_assert(py_args_pos == n_py_args);
+    }
+
+    if (plan->callback_index != G_MAXUINT8) {
+        if (!_pygi_create_callback (self, py_args, plan->callback_index,
+                                    plan->callback_py_pos, plan->user_data_py_pos,
+                                    &state->closure, &state->native_callback))
+            return FALSE;
+    }
+
+    /* Convert the input arguments. */
+    {
+        Py_ssize_t py_args_pos;
+        gsize backup_args_pos;
+        PyObject **stolen_objects;
+        GArgument **stolen_args;
+        gsize n_stolen;
+
+        py_args_pos = 0;
+        backup_args_pos = 0;
+
+        stolen_objects = g_newa(PyObject *, plan->n_args + 1);
+        stolen_args = g_newa(GArgument *, plan->n_args + 1);
+        n_stolen = 0;
+
+        if (plan->is_constructor) {
+            /* Skip the first argument. */
+            py_args_pos += 1;
+        } else if (plan->is_method) {
+            /* Get the instance. */
+            GIBaseInfo *container_info;
+            GIInfoType container_info_type;
+            PyObject *py_arg;
+
+            container_info = g_base_info_get_container((GIBaseInfo *)plan->info);
+            container_info_type = g_base_info_get_type(container_info);
+
+            g_assert(py_args_pos < n_py_args);
+            py_arg = PyTuple_GET_ITEM(py_args, py_args_pos);
+
+            switch(container_info_type) {
+                case GI_INFO_TYPE_UNION:
+                    PyErr_SetString(PyExc_NotImplementedError, "calling methods on unions is not supported yet.");
+                    return FALSE;
+                case GI_INFO_TYPE_STRUCT:
+                {
+                    GType type;
+
+                    type = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *)container_info);
+
+                    if (g_type_is_a(type, G_TYPE_BOXED)) {
+                        g_assert(plan->n_in_args > 0);
+                        if (!_pygi_steal_check_not_consumed(py_arg)) {
+                            return FALSE;
+                        }
+                        state->in_args[0].v_pointer = pyg_boxed_get(py_arg, void);
+                    } else if (g_type_is_a(type, G_TYPE_POINTER) || type == G_TYPE_NONE) {
+                        g_assert(plan->n_in_args > 0);
+                        state->in_args[0].v_pointer = pyg_pointer_get(py_arg, void);
+                    } else {
+                        PyErr_Format(PyExc_TypeError, "unable to convert an instance of '%s'", g_type_name(type));
+                        return FALSE;
+                    }
+
+                    break;
+                }
+                case GI_INFO_TYPE_OBJECT:
+                case GI_INFO_TYPE_INTERFACE:
+                    g_assert(plan->n_in_args > 0);
+                    state->in_args[0].v_pointer = pygobject_get(py_arg);
+                    break;
+                default:
+                    /* Other types don't have methods. */
+                    g_assert_not_reached();
+            }
+
+            py_args_pos += 1;
+        }
+
+        for (i = 0; i < plan->n_args; i++) {
+            PyGIArgPlan *arg = &plan->args[i];
+            GArgument **args = state->args;
+
+            if (state->native_callback != NULL) {
+                /* Native callbacks only get user data given as a C object
+                 * or a capsule, and need no notify. */
+                if (i == plan->callback_index) {
+                    args[i]->v_pointer = state->native_callback;
+                    py_args_pos++;
+                    continue;
+                } else if (i == plan->user_data_index) {
+                    PyObject *py_user_data;
+
+                    g_assert(py_args_pos < PyTuple_GET_SIZE(py_args));
+                    py_user_data = PyTuple_GET_ITEM(py_args, py_args_pos);
+                    if (py_user_data == Py_None) {
+                        args[i]->v_pointer = NULL;
+                    } else if (PyCObject_Check(py_user_data)) {
+                        args[i]->v_pointer = PyCObject_AsVoidPtr(py_user_data);
+#if PY_VERSION_HEX >= 0x02070000
+                    } else if (PyCapsule_CheckExact(py_user_data)) {
+                        args[i]->v_pointer = PyCapsule_GetPointer(py_user_data,
+                                PyCapsule_GetName(py_user_data));
+#endif
+                    } else {
+                        PyErr_Format(PyExc_TypeError,
+                                "user data for a native callback must be None, "
+                                "a C object or a capsule, not %s",
+                                py_user_data->ob_type->tp_name);
+                        return FALSE;
+                    }
+                    py_args_pos++;
+                    continue;
+                } else if (i == plan->destroy_notify_index) {
+                    args[i]->v_pointer = NULL;
+                    continue;
+                }
+            }
+
+            if (i == plan->callback_index) {
+                args[i]->v_pointer = state->closure->closure;
+                py_args_pos++;
+                continue;
+            } else if (i == plan->user_data_index) {
+                args[i]->v_pointer = state->closure;
+                py_args_pos++;
+                continue;
+            } else if (i == plan->destroy_notify_index) {
+                args[i]->v_pointer = _pygi_destroy_notify_create();
+                continue;
+            }
+
+            if (arg->is_auxiliary) {
+                continue;
+            }
+
+            if (arg->direction == GI_DIRECTION_IN || arg->direction == GI_DIRECTION_INOUT) {
+                PyObject *py_arg;
+
+                if (arg->type_tag == GI_TYPE_TAG_ERROR) {
+                    GError **error;
+
+                    error = g_slice_new(GError *);
+                    *error = NULL;
+
+                    args[i]->v_pointer = error;
+                    continue;
+                }
+
+                g_assert(py_args_pos < n_py_args);
+                py_arg = PyTuple_GET_ITEM(py_args, py_args_pos);
+
+                if (_pygi_steal_check(py_arg)) {
+                    PyObject *py_object = ((PyGISteal *)py_arg)->object;
+                    gsize j;
+
+                    /* Move the payload into the callee rather than copying it,
+                     * once every argument is converted, so that the wrapper is
+                     * left as it was if one of them fails. */
+                    if (!_pygi_steal_check_argument(py_object)) {
+                        return FALSE;
+                    }
+                    for (j = 0; j < n_stolen; j++) {
+                        if (stolen_objects[j] == py_object) {
+                            PyErr_Format(PyExc_ValueError, "argument %zd: this %s is already stolen",
+                                    py_args_pos, py_object->ob_type->tp_name);
+                            return FALSE;
+                        }
+                    }
+                    stolen_objects[n_stolen] = py_object;
+                    stolen_args[n_stolen] = args[i];
+                    n_stolen++;
+                    args[i]->v_pointer = NULL;
+                } else {
+                    *args[i] = _pygi_argument_from_object(py_arg, arg->type_info, arg->transfer);
+                }
+
+                if (PyErr_Occurred()) {
+                    /* TODO: release previous input arguments. */
+                    return FALSE;
+                }
+
+                if (arg->direction == GI_DIRECTION_INOUT && arg->transfer == GI_TRANSFER_NOTHING) {
+                    /* We need to keep a copy of the argument to be able to release it later. */
+                    g_assert(backup_args_pos < plan->n_backup_args);
+                    state->backup_args[backup_args_pos] = *args[i];
+                    backup_args_pos += 1;
+                } else if (arg->transfer == GI_TRANSFER_CONTAINER) {
+                    /* We need to keep a copy of the items to be able to release them later. */
+                    switch (arg->type_tag) {
+                        case GI_TYPE_TAG_ARRAY:
+                        {
+                            GArray *array;
+                            gsize item_size;
+                            GArray *new_array;
+
+                            array = args[i]->v_pointer;
+
+                            item_size = g_array_get_element_size(array);
+
+                            new_array = g_array_sized_new(FALSE, FALSE, item_size, array->len);
+                            g_array_append_vals(new_array, array->data, array->len);
+
+                            g_assert(backup_args_pos < plan->n_backup_args);
+                            state->backup_args[backup_args_pos].v_pointer = new_array;
+
+                            break;
+                        }
+                        case GI_TYPE_TAG_GLIST:
+                            g_assert(backup_args_pos < plan->n_backup_args);
+                            state->backup_args[backup_args_pos].v_pointer = g_list_copy(args[i]->v_pointer);
+                            break;
+                        case GI_TYPE_TAG_GSLIST:
+                            g_assert(backup_args_pos < plan->n_backup_args);
+                            state->backup_args[backup_args_pos].v_pointer = g_slist_copy(args[i]->v_pointer);
+                            break;
+                        case GI_TYPE_TAG_GHASH:
+                        {
+                            GHashTable *hash_table;
+                            GList *keys;
+                            GList *values;
+
+                            hash_table = args[i]->v_pointer;
+
+                            keys = g_hash_table_get_keys(hash_table);
+                            values = g_hash_table_get_values(hash_table);
+
+                            g_assert(backup_args_pos < plan->n_backup_args);
+                            state->backup_args[backup_args_pos].v_pointer = g_list_concat(keys, values);
+
+                            break;
+                        }
+                        default:
+                            g_warn_if_reached();
+                    }
+
+                    backup_args_pos += 1;
+                }
+
+                if (arg->type_tag == GI_TYPE_TAG_ARRAY) {
+                    GArray *array;
+
+                    array = args[i]->v_pointer;
+
+                    if (arg->length_arg_pos >= 0) {
+                        /* Set the auxiliary argument holding the length. */
+                        args[arg->length_arg_pos]->v_size = array->len;
+                    }
+
+                    /* Get rid of the GArray. */
+                    args[i]->v_pointer = array->data;
+
+                    if (arg->direction != GI_DIRECTION_INOUT || arg->transfer != GI_TRANSFER_NOTHING) {
+                        /* The array hasn't been referenced anywhere, so free it to avoid losing memory. */
+                        g_array_free(array, FALSE);
+                    }
+                }
+
+                py_args_pos += 1;
+            }
+        }
+
+        g_assert(py_args_pos == n_py_args);
+        g_assert(backup_args_pos == plan->n_backup_args);
+
+        for (i = 0; i < n_stolen; i++) {
+            _pygi_steal_argument(stolen_objects[i], stolen_args[i]);
+        }
+    }
+
+    return TRUE;
+}
+
+gboolean
+_pygi_invoke_prepare (PyGIBaseInfo    *self,
+                      PyGIInvokeState *state,
+                      PyObject        *py_args)
+{
+    gboolean retval;
+
+    if (G_LIKELY(!_pygi_stats_enabled)) {
+        return _pygi_invoke_prepare_args(self, state, py_args);
+    }
+
+    memset(state->stats_times, 0, sizeof(state->stats_times));
+    state->stats_start = _pygi_stats_now();
+
+    retval = _pygi_invoke_prepare_args(self, state, py_args);
+
+    state->stats_times[_PYGI_STATS_INPUT] = _pygi_stats_now() - state->stats_start;
+    if (!retval) {
+        _pygi_invoke_stats_record(state, TRUE);
+    }
+
+    return retval;
+}
+
+/* Does not touch any Python object, so it can be called without the GIL. */
+gboolean
+_pygi_invoke_call (PyGIInvokeState *state)
+{
+    PyGIInvokePlan *plan = state->plan;
+    guint64 start = 0;
+    gboolean retval;
+
+    if (G_UNLIKELY(state->stats_start != 0)) {
+        start = _pygi_stats_now();
+    }
+
+    PYGI_PROBE2(call__start, plan->name, plan->n_in_args);
+
+    retval = g_function_info_invoke(plan->info,
+            state->in_args, plan->n_in_args, state->out_args, plan->n_out_args,
+            &state->return_arg, &state->error);
+
+    PYGI_PROBE2(call__done, plan->name, retval);
+
+    if (G_UNLIKELY(start != 0)) {
+        state->stats_times[_PYGI_STATS_CALL] = _pygi_stats_now() - start;
+    }
+
+    return retval;
+}
+
+static PyObject *
+_pygi_invoke_process_args (PyGIInvokeState *state,
+                           PyObject        *py_args)
+{
+    PyGIInvokePlan *plan = state->plan;
+    GArgument **args = state->args;
+    PyObject *return_value = NULL;
+    gsize i;
+
+    /* The callee can't call a call-scoped callback anymore. */
+    if (state->closure != NULL && state->closure->scope == GI_SCOPE_TYPE_CALL) {
+        _pygi_invoke_closure_free(state->closure);
+        state->closure = NULL;
+    }
+
+    if (state->error != NULL) {
+        /* TODO: raise the right error, out of the error domain. */
+        PyErr_SetString(PyExc_RuntimeError, state->error->message);
+        g_error_free(state->error);
+        state->error = NULL;
+
+        /* TODO: release input arguments. */
+
+        return NULL;
+    }
+
+    if (plan->error_arg_pos >= 0) {
+        GError **error;
+
+        error = args[plan->error_arg_pos]->v_pointer;
+
+        if (*error != NULL) {
+            /* TODO: raise the right error, out of the error domain, if applicable. */
+            PyErr_SetString(PyExc_Exception, (*error)->message);
+            g_error_free(*error);
+
+            /* TODO: release input arguments. */
+
+            return NULL;
+        }
+    }
+
+    /* Convert the return value. */
+    if (plan->is_constructor) {
+        PyTypeObject *py_type;
+        GIBaseInfo *info;
+        GIInfoType info_type;
+        GITransfer transfer;
+
+        g_assert(PyTuple_GET_SIZE(py_args) > 0);
+        py_type = (PyTypeObject *)PyTuple_GET_ITEM(py_args, 0);
+
+        info = g_type_info_get_interface(plan->return_type_info);
+        g_assert(info != NULL);
+
+        info_type = g_base_info_get_type(info);
+
+        transfer = plan->return_transfer;
+
+        switch (info_type) {
+            case GI_INFO_TYPE_UNION:
+                /* TODO */
+                PyErr_SetString(PyExc_NotImplementedError, "creating unions is not supported yet");
+                g_base_info_unref(info);
+                return NULL;
+            case GI_INFO_TYPE_STRUCT:
+            {
+                GType type;
+
+                type = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *)info);
+
+                if (g_type_is_a(type, G_TYPE_BOXED)) {
+                    if (state->return_arg.v_pointer == NULL) {
+                        PyErr_SetString(PyExc_TypeError, "constructor returned NULL");
+                        break;
+                    }
+                    g_warn_if_fail(transfer == GI_TRANSFER_EVERYTHING);
+                    return_value = _pygi_boxed_new(py_type, state->return_arg.v_pointer, transfer == GI_TRANSFER_EVERYTHING);
+                } else if (g_type_is_a(type, G_TYPE_POINTER) || type == G_TYPE_NONE) {
+                    if (state->return_arg.v_pointer == NULL) {
+                        PyErr_SetString(PyExc_TypeError, "constructor returned NULL");
+                        break;
+                    }
+                    g_warn_if_fail(transfer == GI_TRANSFER_NOTHING);
+                    return_value = _pygi_struct_new(py_type, state->return_arg.v_pointer, transfer == GI_TRANSFER_EVERYTHING);
+                } else {
+                    PyErr_Format(PyExc_TypeError, "cannot create '%s' instances", py_type->tp_name);
+                    g_base_info_unref(info);
+                    return NULL;
+                }
+
+                break;
+            }
+            case GI_INFO_TYPE_OBJECT:
+                if (state->return_arg.v_pointer == NULL) {
+                    PyErr_SetString(PyExc_TypeError, "constructor returned NULL");
+                    break;
+                }
+                return_value = pygobject_new(state->return_arg.v_pointer);
+                if (transfer == GI_TRANSFER_EVERYTHING) {
+                    /* The new wrapper increased the reference count, so decrease it. */
+                    g_object_unref (state->return_arg.v_pointer);
+                }
+                break;
+            default:
+                /* Other types don't have neither methods nor constructors. */
+                g_assert_not_reached();
+        }
+
+        g_base_info_unref(info);
+
+        if (return_value == NULL) {
+            /* TODO: release arguments. */
+            return NULL;
+        }
+    } else {
+        if (plan->return_type_tag == GI_TYPE_TAG_ARRAY) {
+            /* Create a #GArray. */
+            state->return_arg.v_pointer = _pygi_argument_to_array(&state->return_arg, args,
+                    plan->return_type_info, plan->is_method);
+        }
+
+        return_value = _pygi_argument_to_object(&state->return_arg, plan->return_type_info,
+                plan->return_transfer);
+        if (return_value == NULL) {
+            /* TODO: release argument. */
+            return NULL;
+        }
+
+        _pygi_argument_release(&state->return_arg, plan->return_type_info,
+                plan->return_transfer, GI_DIRECTION_OUT);
+
+        if (plan->return_type_tag == GI_TYPE_TAG_ARRAY
+                && plan->return_transfer == GI_TRANSFER_NOTHING) {
+            /* We created a #GArray, so free it. */
+            state->return_arg.v_pointer = g_array_free(state->return_arg.v_pointer, FALSE);
+        }
+    }
+
+    /* Convert output arguments and release arguments. */
+    {
+        gsize backup_args_pos;
+        gsize return_values_pos;
+
+        backup_args_pos = 0;
+        return_values_pos = 0;
+
+        if (plan->n_return_values > 1) {
+            /* Return a tuple. */
+            PyObject *return_values;
+
+            return_values = PyTuple_New(plan->n_return_values);
+            if (return_values == NULL) {
+                /* TODO: release arguments. */
+                Py_DECREF(return_value);
+                return NULL;
+            }
+
+            if (plan->return_type_tag == GI_TYPE_TAG_VOID) {
+                /* The current return value is None. */
+                Py_DECREF(return_value);
+            } else {
+                /* Put the return value first. */
+                g_assert(return_value != NULL);
+                PyTuple_SET_ITEM(return_values, return_values_pos, return_value);
+                return_values_pos += 1;
+            }
+
+            return_value = return_values;
+        }
+
+        for (i = 0; i < plan->n_args; i++) {
+            PyGIArgPlan *arg = &plan->args[i];
+            GIDirection direction;
+            GITypeTag type_tag;
+            GITransfer transfer;
+
+            if (arg->is_auxiliary) {
+                /* Auxiliary arguments are handled at the same time as their relatives. */
+                continue;
+            }
+
+            direction = arg->direction;
+            transfer = arg->transfer;
+            type_tag = arg->type_tag;
+
+            if (type_tag == GI_TYPE_TAG_ARRAY
+                    && (direction != GI_DIRECTION_IN || transfer == GI_TRANSFER_NOTHING)) {
+                /* Create a #GArray. */
+                args[i]->v_pointer = _pygi_argument_to_array(args[i], args, arg->type_info, plan->is_method);
+            }
+
+            if (direction == GI_DIRECTION_INOUT || direction == GI_DIRECTION_OUT) {
+                /* Convert the argument. */
+                PyObject *obj;
+
+                obj = _pygi_argument_to_object(args[i], arg->type_info, transfer);
+                if (obj == NULL) {
+                    /* TODO: release arguments. */
+                    Py_DECREF(return_value);
+                    return NULL;
+                }
+
+                g_assert(return_values_pos < plan->n_return_values);
+
+                if (plan->n_return_values > 1) {
+                    PyTuple_SET_ITEM(return_value, return_values_pos, obj);
+                } else {
+                    /* The current return value is None. */
+                    Py_DECREF(return_value);
+                    return_value = obj;
+                }
+
+                return_values_pos += 1;
+            }
+
+            /* Release the argument. */
+
+            if ((direction == GI_DIRECTION_IN || direction == GI_DIRECTION_INOUT)
+                    && transfer == GI_TRANSFER_CONTAINER) {
+                /* Release the items we kept in another container. */
+                switch (type_tag) {
+                    case GI_TYPE_TAG_ARRAY:
+                    case GI_TYPE_TAG_GLIST:
+                    case GI_TYPE_TAG_GSLIST:
+                        g_assert(backup_args_pos < plan->n_backup_args);
+                        _pygi_argument_release(&state->backup_args[backup_args_pos], arg->type_info,
+                            transfer, GI_DIRECTION_IN);
+                        break;
+                    case GI_TYPE_TAG_GHASH:
+                    {
+                        GITypeInfo *key_type_info;
+                        GITypeInfo *value_type_info;
+                        GList *item;
+                        gsize length;
+                        gsize j;
+
+                        key_type_info = g_type_info_get_param_type(arg->type_info, 0);
+                        value_type_info = g_type_info_get_param_type(arg->type_info, 1);
+
+                        g_assert(backup_args_pos < plan->n_backup_args);
+                        item = state->backup_args[backup_args_pos].v_pointer;
+
+                        length = g_list_length(item) / 2;
+
+                        for (j = 0; j < length; j++, item = g_list_next(item)) {
+                            _pygi_argument_release((GArgument *)&item->data, key_type_info,
+                                GI_TRANSFER_NOTHING, GI_DIRECTION_IN);
+                        }
+
+                        for (j = 0; j < length; j++, item = g_list_next(item)) {
+                            _pygi_argument_release((GArgument *)&item->data, value_type_info,
+                                GI_TRANSFER_NOTHING, GI_DIRECTION_IN);
+                        }
+
+                        g_list_free(state->backup_args[backup_args_pos].v_pointer);
+
+                        g_base_info_unref((GIBaseInfo *)key_type_info);
+                        g_base_info_unref((GIBaseInfo *)value_type_info);
+
+                        break;
+                    }
+                    default:
+                        g_warn_if_reached();
+                }
+
+                if (direction == GI_DIRECTION_INOUT) {
+                    /* Release the output argument. */
+                    _pygi_argument_release(args[i], arg->type_info, GI_TRANSFER_CONTAINER,
+                        GI_DIRECTION_OUT);
+                }
+
+                backup_args_pos += 1;
+            } else if (direction == GI_DIRECTION_INOUT) {
+                if (transfer == GI_TRANSFER_NOTHING) {
+                    g_assert(backup_args_pos < plan->n_backup_args);
+                    _pygi_argument_release(&state->backup_args[backup_args_pos], arg->type_info,
+                        GI_TRANSFER_NOTHING, GI_DIRECTION_IN);
+                    backup_args_pos += 1;
+                }
+
+                _pygi_argument_release(args[i], arg->type_info, transfer,
+                    GI_DIRECTION_OUT);
+            } else {
+                _pygi_argument_release(args[i], arg->type_info, transfer, direction);
+            }
+
+            if (type_tag == GI_TYPE_TAG_ARRAY
+                    && (direction != GI_DIRECTION_IN && transfer == GI_TRANSFER_NOTHING)) {
+                /* We created a #GArray and it has not been released above, so free it. */
+                args[i]->v_pointer = g_array_free(args[i]->v_pointer, FALSE);
+            }
+        }
+
+        g_assert(plan->n_return_values <= 1 || return_values_pos == plan->n_return_values);
+        g_assert(backup_args_pos == plan->n_backup_args);
+    }
+
+    return return_value;
+}
+
+PyObject *
+_pygi_invoke_process (PyGIInvokeState *state,
+                      PyObject        *py_args)
+{
+    PyObject *return_value;
+    guint64 start;
+
+    if (G_LIKELY(state->stats_start == 0)) {
+        return _pygi_invoke_process_args(state, py_args);
+    }
+
+    start = _pygi_stats_now();
+
+    return_value = _pygi_invoke_process_args(state, py_args);
+
+    state->stats_times[_PYGI_STATS_OUTPUT] = _pygi_stats_now() - start;
+    _pygi_invoke_stats_record(state, return_value == NULL);
+
+    return return_value;
+}
+
+PyObject *
+_wrap_g_function_info_invoke (PyGIBaseInfo *self,
+                              PyObject     *py_args)
+{
+    PyGIInvokePlan *plan;
+    PyGIInvokeState state;
+    PyThreadState *tstate;
+    PyObject *py_profile_function = NULL;
+    PyObject *retval = NULL;
+    guint64 trace_start = 0;
+
+    plan = _pygi_invoke_plan_get(self);
+    if (plan == NULL) {
+        return NULL;
+    }
+
+    PYGI_PROBE2(invoke__entry, plan->name, plan->n_in_args);
+
+    /* Methods are not called through a builtin function, so report the
+     * call to profilers in their place. */
+    tstate = PyThreadState_GET();
+    if (_pygi_profile_active(tstate)) {
+        py_profile_function = _pygi_profile_call(tstate, (GIBaseInfo *)plan->info,
+                                                 &plan->py_profile_function);
+        if (py_profile_function == NULL) {
+            PYGI_PROBE2(invoke__return, plan->name, TRUE);
+            return NULL;
+        }
+    }
+
+    if (_pygi_trace_active()) {
+        trace_start = _pygi_stats_now();
+    }
+
+    _pygi_invoke_state_init(&state, plan, g_alloca(plan->state_size));
+
+    if (_pygi_invoke_prepare(self, &state, py_args)) {
+        _pygi_invoke_call(&state);
+        retval = _pygi_invoke_process(&state, py_args);
+    }
+
+    /* The recording may have been stopped by the call. */
+    if (G_UNLIKELY(trace_start != 0) && _pygi_trace_active()) {
+        _pygi_trace_record(plan->name, py_args, _pygi_stats_now() - trace_start,
+                           retval == NULL);
+    }
+
+    if (G_UNLIKELY(py_profile_function != NULL)) {
+        _pygi_profile_return(tstate, py_profile_function, retval == NULL);
+    }
+
+    PYGI_PROBE2(invoke__return, plan->name, retval == NULL);
+
+    return retval;
+}
+
+/* Invoke the function for each tuple of arguments, converting them by
+ * chunks so that the calls of a chunk are made without the GIL. */
+PyObject *
+_wrap_g_function_info_invoke_many (PyGIBaseInfo *self,
+                                   PyObject     *args,
+                                   PyObject     *kwargs)
+{
+    static char *kwlist[] = { "args", "discard", "chunk_size", NULL };
+
+    PyObject *py_iterable;
+    PyObject *py_discard = Py_False;
+    Py_ssize_t chunk_size = 1;
+    PyGIInvokePlan *plan;
+    PyObject *py_iterator;
+    PyObject *py_results = NULL;
+    PyObject *py_error_type = NULL, *py_error_value = NULL, *py_error_traceback = NULL;
+    PyGIInvokeState *states;
+    PyObject **py_args_chunk;
+    guint8 *storage;
+    gsize stride;
+    Py_ssize_t length_hint;
+    int discard;
+    gboolean done = FALSE;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|On:FunctionInfo.invoke_many",
+            kwlist, &py_iterable, &py_discard, &chunk_size)) {
+        return NULL;
+    }
+
+    if (chunk_size < 1) {
+        PyErr_SetString(PyExc_ValueError, "chunk_size must be positive");
+        return NULL;
+    }
+
+    discard = PyObject_IsTrue(py_discard);
+    if (discard < 0) {
+        return NULL;
+    }
+
+    plan = _pygi_invoke_plan_get(self);
+    if (plan == NULL) {
+        return NULL;
+    }
+
+    /* Chunks need no more room than there are calls. */
+    length_hint = _PyObject_LengthHint(py_iterable, chunk_size);
+    if (length_hint < 0) {
+        return NULL;
+    }
+    chunk_size = MAX(MIN(chunk_size, length_hint), 1);
+
+    /* Keep the GArgument arrays of each state aligned. */
+    stride = (plan->state_size + sizeof(GArgument) - 1) / sizeof(GArgument) * sizeof(GArgument);
+
+    if ((gsize)chunk_size > G_MAXSIZE / MAX(stride, sizeof(PyGIInvokeState))) {
+        return PyErr_NoMemory();
+    }
+
+    states = g_try_new(PyGIInvokeState, chunk_size);
+    py_args_chunk = g_try_new(PyObject *, chunk_size);
+    storage = g_try_malloc(chunk_size * stride);
+    if (states == NULL || py_args_chunk == NULL || (storage == NULL && stride > 0)) {
+        g_free(storage);
+        g_free(py_args_chunk);
+        g_free(states);
+        return PyErr_NoMemory();
+    }
+
+    py_iterator = PyObject_GetIter(py_iterable);
+    if (py_iterator == NULL) {
+        g_free(storage);
+        g_free(py_args_chunk);
+        g_free(states);
+        return NULL;
+    }
+
+    if (!discard) {
+        py_results = PyList_New(0);
+        if (py_results == NULL) {
+            g_free(storage);
+            g_free(py_args_chunk);
+            g_free(states);
+            Py_DECREF(py_iterator);
+            return NULL;
+        }
+    }
+
+    while (!done) {
+        Py_ssize_t i, n_calls = 0;
+
+        /* Convert the arguments of a chunk. */
+        while (n_calls < chunk_size) {
+            PyObject *py_item;
+            PyObject *py_args;
+
+            py_item = PyIter_Next(py_iterator);
+            if (py_item == NULL) {
+                done = TRUE;
+                break;
+            }
+
+            py_args = PySequence_Tuple(py_item);
+            Py_DECREF(py_item);
+            if (py_args == NULL) {
+                done = TRUE;
+                break;
+            }
+
+            _pygi_invoke_state_init(&states[n_calls], plan, storage + n_calls * stride);
+
+            if (!_pygi_invoke_prepare(self, &states[n_calls], py_args)) {
+                Py_DECREF(py_args);
+                done = TRUE;
+                break;
+            }
+
+            py_args_chunk[n_calls] = py_args;
+            n_calls++;
+        }
+
+        if (PyErr_Occurred()) {
+            PyErr_Fetch(&py_error_type, &py_error_value, &py_error_traceback);
+        }
+
+        /* The calls converted before an error are still made. */
+        if (n_calls > 1) {
+            Py_BEGIN_ALLOW_THREADS
+            for (i = 0; i < n_calls; i++) {
+                _pygi_invoke_call(&states[i]);
+            }
+            Py_END_ALLOW_THREADS
+        } else if (n_calls == 1) {
+            _pygi_invoke_call(&states[0]);
+        }
+
+        for (i = 0; i < n_calls; i++) {
+            PyObject *py_result;
+
+            py_result = _pygi_invoke_process(&states[i], py_args_chunk[i]);
+            Py_DECREF(py_args_chunk[i]);
+
+            if (py_result == NULL) {
+                /* Only the first error is raised. */
+                if (py_error_type == NULL) {
+                    PyErr_Fetch(&py_error_type, &py_error_value, &py_error_traceback);
+                } else {
+                    PyErr_Clear();
+                }
+                done = TRUE;
+                continue;
+            }
+
+            if (py_results != NULL && py_error_type == NULL
+                    && PyList_Append(py_results, py_result) < 0) {
+                PyErr_Fetch(&py_error_type, &py_error_value, &py_error_traceback);
+                done = TRUE;
+            }
+
+            Py_DECREF(py_result);
+        }
+    }
+
+    g_free(storage);
+    g_free(py_args_chunk);
+    g_free(states);
+    Py_DECREF(py_iterator);
+
+    if (py_error_type != NULL) {
+        PyErr_Restore(py_error_type, py_error_value, py_error_traceback);
+        Py_XDECREF(py_results);
+        return NULL;
+    }
+
+    if (py_results == NULL) {
+        Py_RETURN_NONE;
+    }
+
+    return py_results;
+}
+
+PyObject *
+_wrap_g_function_info_prepare (PyGIBaseInfo *self)
+{
+    if (_pygi_invoke_plan_get(self) == NULL) {
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
@@ -0,0 +1,140 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ * Copyright (C) 2005-2009 Johan Dahlin <johan@gnome.org>
+ *
+ *   pygi-invoke.h: FunctionInfo invocation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_INVOKE_H__
+#define __PYGI_INVOKE_H__
+
+#include <Python.h>
+
+#include <girepository.h>
+
+#include "pygi-stats.h"
+
+G_BEGIN_DECLS
+
+/* Everything about an argument that does not depend on the values passed. */
+typedef struct {
+    GIArgInfo *arg_info;
+    GITypeInfo *type_info;
+    GIDirection direction;
+    GITransfer transfer;
+    GITypeTag type_tag;
+    gint length_arg_pos;    /* -1 unless an array with a length argument */
+    gboolean is_auxiliary;
+} PyGIArgPlan;
+
+/* The static part of an invocation, computed once per FunctionInfo. */
+struct _PyGIInvokePlan {
+    GIFunctionInfo *info;
+
+    gboolean is_method;
+    gboolean is_constructor;
+
+    gsize n_args;
+    gsize n_in_args;
+    gsize n_out_args;
+    gsize n_backup_args;
+    gsize n_aux_in_args;
+    gsize n_aux_out_args;
+    gsize n_return_values;
+    Py_ssize_t n_py_args;
+
+    guint8 callback_index;
+    guint8 user_data_index;
+    guint8 destroy_notify_index;
+
+    /* Positions in the Python arguments, or -1. */
+    Py_ssize_t callback_py_pos;
+    Py_ssize_t user_data_py_pos;
+
+    glong error_arg_pos;
+
+    /* Qualified name, given to the probes. */
+    gchar *name;
+
+    PyGIArgPlan *args;
+
+    GITypeInfo *return_type_info;
+    GITypeTag return_type_tag;
+    GITransfer return_transfer;
+
+    /* Size of the storage needed by _pygi_invoke_state_init(). */
+    gsize state_size;
+
+    /* The _finish counterpart, looked up by invoke_future(). */
+    PyObject *py_finish_info;
+
+    PyGIStats *stats;
+
+    /* What stands for the function in profiles, owned by the registry. */
+    PyObject *py_profile_function;
+};
+
+/* The dynamic part of an invocation. */
+typedef struct {
+    PyGIInvokePlan *plan;
+
+    PyGICClosure *closure;
+    gpointer native_callback;
+
+    GArgument **args;
+    GArgument *in_args;
+    GArgument *out_args;
+    GArgument *out_values;
+    GArgument *backup_args;
+    GArgument return_arg;
+
+    GError *error;
+
+    /* Nonzero if the invocation is timed. */
+    guint64 stats_start;
+    guint64 stats_times[_PYGI_STATS_N_PHASES];
+} PyGIInvokeState;
+
+
+/* Private */
+
+PyGIInvokePlan *_pygi_invoke_plan_get (PyGIBaseInfo *self);
+void _pygi_invoke_plan_free (PyGIInvokePlan *plan);
+
+void _pygi_invoke_state_init (PyGIInvokeState *state,
+                              PyGIInvokePlan  *plan,
+                              gpointer         storage);
+
+gboolean _pygi_invoke_prepare (PyGIBaseInfo    *self,
+                               PyGIInvokeState *state,
+                               PyObject        *py_args);
+gboolean _pygi_invoke_call (PyGIInvokeState *state);
+PyObject *_pygi_invoke_process (PyGIInvokeState *state,
+                                PyObject        *py_args);
+
+PyObject *_wrap_g_function_info_invoke (PyGIBaseInfo *self,
+                                        PyObject     *py_args);
+PyObject *_wrap_g_function_info_invoke_many (PyGIBaseInfo *self,
+                                             PyObject     *args,
+                                             PyObject     *kwargs);
+PyObject *_wrap_g_function_info_prepare (PyGIBaseInfo *self);
+
+G_END_DECLS
+
+#endif /* __PYGI_INVOKE_H__ */
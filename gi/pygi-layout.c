@@ -0,0 +1,247 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-layout.c: memoized layout of structures.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+/* Layouts are never freed, like typelibs.  Registered structures are keyed
+ * by their GType, others by their typelib and name, and anonymous ones by
+ * their typelib and fields, as the layout only depends on those. */
+static GHashTable *_pygi_struct_layouts_by_g_type = NULL;
+static GHashTable *_pygi_struct_layouts_by_name = NULL;
+
+static gboolean
+_pygi_field_layout_init (PyGIFieldLayout *field_layout,
+                         GIFieldInfo     *field_info)
+{
+    GITypeInfo *field_type_info;
+    gboolean is_simple = TRUE;
+
+    field_type_info = g_field_info_get_type(field_info);
+
+    field_layout->name = g_base_info_get_name((GIBaseInfo *)field_info);
+    field_layout->offset = g_field_info_get_offset(field_info);
+    field_layout->size = _pygi_g_type_info_size(field_type_info);
+    field_layout->type_tag = g_type_info_get_tag(field_type_info);
+    field_layout->is_pointer = g_type_info_is_pointer(field_type_info);
+    field_layout->struct_layout = NULL;
+
+    switch (field_layout->type_tag) {
+        case GI_TYPE_TAG_BOOLEAN:
+        case GI_TYPE_TAG_INT8:
+        case GI_TYPE_TAG_UINT8:
+        case GI_TYPE_TAG_INT16:
+        case GI_TYPE_TAG_UINT16:
+        case GI_TYPE_TAG_INT32:
+        case GI_TYPE_TAG_UINT32:
+        case GI_TYPE_TAG_SHORT:
+        case GI_TYPE_TAG_USHORT:
+        case GI_TYPE_TAG_INT:
+        case GI_TYPE_TAG_UINT:
+        case GI_TYPE_TAG_INT64:
+        case GI_TYPE_TAG_UINT64:
+        case GI_TYPE_TAG_LONG:
+        case GI_TYPE_TAG_ULONG:
+        case GI_TYPE_TAG_SSIZE:
+        case GI_TYPE_TAG_SIZE:
+        case GI_TYPE_TAG_FLOAT:
+        case GI_TYPE_TAG_DOUBLE:
+        case GI_TYPE_TAG_TIME_T:
+            is_simple = !field_layout->is_pointer;
+            break;
+        case GI_TYPE_TAG_VOID:
+        case GI_TYPE_TAG_GTYPE:
+        case GI_TYPE_TAG_ERROR:
+        case GI_TYPE_TAG_UTF8:
+        case GI_TYPE_TAG_FILENAME:
+        case GI_TYPE_TAG_ARRAY:
+        case GI_TYPE_TAG_GLIST:
+        case GI_TYPE_TAG_GSLIST:
+        case GI_TYPE_TAG_GHASH:
+            is_simple = FALSE;
+            break;
+        case GI_TYPE_TAG_INTERFACE:
+        {
+            GIBaseInfo *info;
+            GIInfoType info_type;
+
+            info = g_type_info_get_interface(field_type_info);
+            info_type = g_base_info_get_type(info);
+
+            switch (info_type) {
+                case GI_INFO_TYPE_STRUCT:
+                    if (field_layout->is_pointer) {
+                        is_simple = FALSE;
+                    } else {
+                        field_layout->struct_layout = _pygi_struct_layout_get((GIStructInfo *)info);
+                        is_simple = field_layout->struct_layout->is_simple;
+                    }
+                    break;
+                case GI_INFO_TYPE_UNION:
+                    /* TODO */
+                    is_simple = FALSE;
+                    break;
+                case GI_INFO_TYPE_ENUM:
+                case GI_INFO_TYPE_FLAGS:
+                    if (field_layout->is_pointer) {
+                        is_simple = FALSE;
+                    } else {
+                        field_layout->type_tag = g_enum_info_get_storage_type((GIEnumInfo *)info);
+                    }
+                    break;
+                case GI_INFO_TYPE_BOXED:
+                case GI_INFO_TYPE_OBJECT:
+                case GI_INFO_TYPE_CALLBACK:
+                case GI_INFO_TYPE_INTERFACE:
+                    is_simple = FALSE;
+                    break;
+                case GI_INFO_TYPE_VFUNC:
+                case GI_INFO_TYPE_INVALID:
+                case GI_INFO_TYPE_FUNCTION:
+                case GI_INFO_TYPE_CONSTANT:
+                case GI_INFO_TYPE_ERROR_DOMAIN:
+                case GI_INFO_TYPE_VALUE:
+                case GI_INFO_TYPE_SIGNAL:
+                case GI_INFO_TYPE_PROPERTY:
+                case GI_INFO_TYPE_FIELD:
+                case GI_INFO_TYPE_ARG:
+                case GI_INFO_TYPE_TYPE:
+                case GI_INFO_TYPE_UNRESOLVED:
+                    g_assert_not_reached();
+            }
+
+            g_base_info_unref(info);
+            break;
+        }
+    }
+
+    g_base_info_unref((GIBaseInfo *)field_type_info);
+
+    return is_simple;
+}
+
+static PyGIStructLayout *
+_pygi_struct_layout_new (GIStructInfo *struct_info)
+{
+    PyGIStructLayout *layout;
+    gsize i;
+
+    layout = g_slice_new0(PyGIStructLayout);
+    layout->size = g_struct_info_get_size(struct_info);
+    layout->alignment = g_struct_info_get_alignment(struct_info);
+    layout->is_simple = TRUE;
+    layout->n_fields = g_struct_info_get_n_fields(struct_info);
+    layout->fields = g_new0(PyGIFieldLayout, layout->n_fields);
+
+    for (i = 0; i < layout->n_fields; i++) {
+        GIFieldInfo *field_info;
+
+        field_info = g_struct_info_get_field(struct_info, i);
+        if (!_pygi_field_layout_init(&layout->fields[i], field_info)) {
+            layout->is_simple = FALSE;
+        }
+        g_base_info_unref((GIBaseInfo *)field_info);
+    }
+
+    return layout;
+}
+
+static gchar *
+_pygi_struct_layout_get_key (GIStructInfo     *struct_info,
+                             PyGIStructLayout *layout)
+{
+    GTypelib *typelib;
+    const gchar *name;
+    GString *key;
+    gsize i;
+
+    typelib = g_base_info_get_typelib((GIBaseInfo *)struct_info);
+    name = g_base_info_get_name((GIBaseInfo *)struct_info);
+
+    if (name != NULL && name[0] != '\0') {
+        return g_strdup_printf("%p:%s", (gpointer)typelib, name);
+    }
+
+    key = g_string_new(NULL);
+    g_string_append_printf(key, "%p:(%" G_GSIZE_FORMAT ")", (gpointer)typelib, layout->size);
+    for (i = 0; i < layout->n_fields; i++) {
+        PyGIFieldLayout *field_layout = &layout->fields[i];
+
+        g_string_append_printf(key, "%s@%" G_GSIZE_FORMAT ":%d%s%p,",
+                field_layout->name, field_layout->offset, field_layout->type_tag,
+                field_layout->is_pointer ? "*" : "", (gpointer)field_layout->struct_layout);
+    }
+
+    return g_string_free(key, FALSE);
+}
+
+PyGIStructLayout *
+_pygi_struct_layout_get (GIStructInfo *struct_info)
+{
+    GType g_type;
+    const gchar *name;
+    gchar *key;
+    PyGIStructLayout *layout;
+
+    if (_pygi_struct_layouts_by_g_type == NULL) {
+        _pygi_struct_layouts_by_g_type = g_hash_table_new(g_direct_hash, g_direct_equal);
+        _pygi_struct_layouts_by_name = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+
+    g_type = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *)struct_info);
+    if (g_type != G_TYPE_NONE) {
+        layout = g_hash_table_lookup(_pygi_struct_layouts_by_g_type, (gpointer)g_type);
+        if (layout == NULL) {
+            layout = _pygi_struct_layout_new(struct_info);
+            g_hash_table_insert(_pygi_struct_layouts_by_g_type, (gpointer)g_type, layout);
+        }
+        return layout;
+    }
+
+    name = g_base_info_get_name((GIBaseInfo *)struct_info);
+    if (name != NULL && name[0] != '\0') {
+        key = _pygi_struct_layout_get_key(struct_info, NULL);
+        layout = g_hash_table_lookup(_pygi_struct_layouts_by_name, key);
+        if (layout != NULL) {
+            g_free(key);
+            return layout;
+        }
+        layout = _pygi_struct_layout_new(struct_info);
+    } else {
+        PyGIStructLayout *other_layout;
+
+        /* Anonymous structures are only known by what they hold. */
+        layout = _pygi_struct_layout_new(struct_info);
+        key = _pygi_struct_layout_get_key(struct_info, layout);
+
+        other_layout = g_hash_table_lookup(_pygi_struct_layouts_by_name, key);
+        if (other_layout != NULL) {
+            g_free(layout->fields);
+            g_slice_free(PyGIStructLayout, layout);
+            g_free(key);
+            return other_layout;
+        }
+    }
+
+    /* The table owns the key. */
+    g_hash_table_insert(_pygi_struct_layouts_by_name, key, layout);
+
+    return layout;
+}
@@ -0,0 +1,59 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-layout.h: memoized layout of structures.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_LAYOUT_H__
+#define __PYGI_LAYOUT_H__
+
+#include <girepository.h>
+
+G_BEGIN_DECLS
+
+typedef struct _PyGIStructLayout PyGIStructLayout;
+
+typedef struct {
+    const gchar *name;
+    gsize offset;
+    gsize size;
+    /* The storage type for enums and flags. */
+    GITypeTag type_tag;
+    gboolean is_pointer;
+    /* Set for structures stored inline. */
+    PyGIStructLayout *struct_layout;
+} PyGIFieldLayout;
+
+struct _PyGIStructLayout {
+    gsize size;
+    gsize alignment;
+    gboolean is_simple;
+    gsize n_fields;
+    PyGIFieldLayout *fields;
+    /* Buffer format, built on first use. */
+    gchar *format;
+};
+
+
+/* Private */
+
+PyGIStructLayout *_pygi_struct_layout_get (GIStructInfo *struct_info);
+
+G_END_DECLS
+
+#endif /* __PYGI_LAYOUT_H__ */
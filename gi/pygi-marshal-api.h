@@ -0,0 +1,95 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-marshal-api.h: marshalling functions for the benchmarks.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_MARSHAL_API_H__
+#define __PYGI_MARSHAL_API_H__
+
+#include <Python.h>
+
+#include <girepository.h>
+
+G_BEGIN_DECLS
+
+/* Exported as gi._gi._marshal_API for tests/bench-marshal.c.  This header
+ * is not installed: the table may change with pygi, unlike PyGI_API.
+ * Objects must be of the right type for the type info. */
+struct PyGIMarshal_API {
+    GArgument (*argument_from_object) (PyObject   *object,
+                                       GITypeInfo *type_info,
+                                       GITransfer  transfer);
+    PyObject* (*argument_to_object) (GArgument  *arg,
+                                     GITypeInfo *type_info,
+                                     GITransfer  transfer);
+    void (*argument_release) (GArgument   *arg,
+                              GITypeInfo  *type_info,
+                              GITransfer   transfer,
+                              GIDirection  direction);
+};
+
+
+#ifndef __PYGI_PRIVATE_H__
+
+static struct PyGIMarshal_API *PyGIMarshal_API = NULL;
+
+#define pygi_argument_from_object (PyGIMarshal_API->argument_from_object)
+#define pygi_argument_to_object (PyGIMarshal_API->argument_to_object)
+#define pygi_argument_release (PyGIMarshal_API->argument_release)
+
+
+static int
+pygi_marshal_import (void)
+{
+    PyObject *module;
+    PyObject *api;
+
+    if (PyGIMarshal_API != NULL) {
+        return 1;
+    }
+
+    module = PyImport_ImportModule("gi._gi");
+    if (module == NULL) {
+        return -1;
+    }
+
+    api = PyObject_GetAttrString(module, "_marshal_API");
+    Py_DECREF(module);
+    if (api == NULL) {
+        return -1;
+    }
+    if (!PyCObject_Check(api)) {
+        PyErr_Format(PyExc_TypeError, "gi._gi._marshal_API must be cobject, not %s",
+                api->ob_type->tp_name);
+        Py_DECREF(api);
+        return -1;
+    }
+
+    PyGIMarshal_API = (struct PyGIMarshal_API *)PyCObject_AsVoidPtr(api);
+
+    Py_DECREF(api);
+
+    return 0;
+}
+
+#endif /* __PYGI_PRIVATE_H__ */
+
+G_END_DECLS
+
+#endif /* __PYGI_MARSHAL_API_H__ */
@@ -27,6 +27,18 @@
 #include "pygi-foreign.h"
 #include "pygi-closure.h"
 #include "pygi-callbacks.h"
+#include "pygi-invoke.h"
+#include "pygi-enum.h"
+#include "pygi-field.h"
+#include "pygi-buffer.h"
+#include "pygi-layout.h"
+#include "pygi-steal.h"
+#include "pygi-dispatch.h"
+#include "pygi-async.h"
+#include "pygi-stats.h"
+#include "pygi-profile.h"
+#include "pygi-probes.h"
+#include "pygi-trace.h"
 
 G_BEGIN_DECLS
 
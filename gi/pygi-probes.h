@@ -0,0 +1,62 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-probes.h: static tracepoints.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_PROBES_H__
+#define __PYGI_PROBES_H__
+
+/* Probes of the pygi provider, for SystemTap, perf or bpftrace.  They are
+ * no-ops until a tracer attaches, but their arguments are still computed,
+ * so they must only be given what is at hand.  Names are qualified names
+ * of callables and type names of wrappers.
+ *
+ *   invoke__entry(name, n_in_args)       FunctionInfo.invoke() called
+ *   invoke__return(name, failed)         FunctionInfo.invoke() returning
+ *   call__start(name, n_in_args)         the native function called
+ *   call__done(name, succeeded)          the native function returned
+ *   closure__entry(name, n_py_args)      a callback called
+ *   closure__return(name, failed)        a callback returning
+ *   boxed__new(type, pointer, owned)     a boxed wrapper created
+ *   boxed__free(type, pointer, owned)    a boxed wrapper deallocated
+ *   struct__new(type, pointer, owned)    a struct wrapper created
+ *   struct__free(type, pointer, owned)   a struct wrapper deallocated
+ */
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define PYGI_PROBES_ENABLED 1
+
+#define PYGI_PROBE1(name, a) DTRACE_PROBE1(pygi, name, a)
+#define PYGI_PROBE2(name, a, b) DTRACE_PROBE2(pygi, name, a, b)
+#define PYGI_PROBE3(name, a, b, c) DTRACE_PROBE3(pygi, name, a, b, c)
+
+#else
+
+#define PYGI_PROBES_ENABLED 0
+
+#define PYGI_PROBE1(name, a)
+#define PYGI_PROBE2(name, a, b)
+#define PYGI_PROBE3(name, a, b, c)
+
+#endif /* HAVE_SYS_SDT_H */
+
+#endif /* __PYGI_PROBES_H__ */
@@ -0,0 +1,161 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-profile.c: profiler events for introspected calls.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+#include <string.h>
+
+/* Profilers label C calls after the method definition and the module of
+ * a builtin function, so each introspected function gets a builtin
+ * standing for it.  They are kept by full name and never freed, as
+ * profilers may key their entries on the method definition. */
+static GHashTable *_pygi_profile_functions = NULL;
+
+static PyObject *
+_pygi_profile_placeholder (PyObject *self,
+                           PyObject *args)
+{
+    PyErr_SetString(PyExc_NotImplementedError,
+            "only stands for an introspected function in profiles");
+    return NULL;
+}
+
+static PyObject *
+_pygi_profile_get_function (GIBaseInfo *info)
+{
+    gchar *fullname;
+    const gchar *name;
+    PyMethodDef *method;
+    PyObject *py_module;
+    PyObject *function;
+
+    fullname = _pygi_g_callable_info_get_qualified_name((GICallableInfo *)info);
+
+    if (_pygi_profile_functions == NULL) {
+        _pygi_profile_functions = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+
+    function = g_hash_table_lookup(_pygi_profile_functions, fullname);
+    if (function != NULL) {
+        g_free(fullname);
+        return function;
+    }
+
+    /* The name is what follows the namespace. */
+    name = strchr(fullname, '.') + 1;
+
+    py_module = PyString_FromString(g_base_info_get_namespace(info));
+    if (py_module == NULL) {
+        g_free(fullname);
+        return NULL;
+    }
+
+    method = g_new0(PyMethodDef, 1);
+    method->ml_name = name;
+    method->ml_meth = _pygi_profile_placeholder;
+    method->ml_flags = METH_VARARGS;
+
+    function = PyCFunction_NewEx(method, NULL, py_module);
+    Py_DECREF(py_module);
+    if (function == NULL) {
+        g_free(method);
+        g_free(fullname);
+        return NULL;
+    }
+
+    g_hash_table_insert(_pygi_profile_functions, fullname, function);
+
+    return function;
+}
+
+/* Like call_trace() in ceval.c. */
+static int
+_pygi_profile_event (PyThreadState *tstate,
+                     int            what,
+                     PyObject      *function)
+{
+    int retval;
+
+    if (tstate->tracing) {
+        return 0;
+    }
+
+    tstate->tracing++;
+    tstate->use_tracing = 0;
+    retval = tstate->c_profilefunc(tstate->c_profileobj, tstate->frame, what, function);
+    tstate->use_tracing = tstate->c_tracefunc != NULL || tstate->c_profilefunc != NULL;
+    tstate->tracing--;
+
+    return retval;
+}
+
+/* Report a call to info, and return the function standing for it, which
+ * is cached in *function.  Returns NULL with an exception if the profiler
+ * failed. */
+PyObject *
+_pygi_profile_call (PyThreadState *tstate,
+                    GIBaseInfo    *info,
+                    PyObject     **function)
+{
+    if (*function == NULL) {
+        *function = _pygi_profile_get_function(info);
+        if (*function == NULL) {
+            return NULL;
+        }
+    }
+
+    if (_pygi_profile_event(tstate, PyTrace_C_CALL, *function) != 0) {
+        return NULL;
+    }
+
+    return *function;
+}
+
+/* Report the end of a call reported by _pygi_profile_call(), keeping the
+ * exception it raised if failed is true. */
+void
+_pygi_profile_return (PyThreadState *tstate,
+                      PyObject      *function,
+                      gboolean       failed)
+{
+    PyObject *py_error_type, *py_error_value, *py_error_traceback;
+
+    if (tstate->c_profilefunc == NULL) {
+        return;
+    }
+
+    if (!failed) {
+        if (_pygi_profile_event(tstate, PyTrace_C_RETURN, function) != 0) {
+            /* There is no way to report it. */
+            PyErr_Clear();
+        }
+        return;
+    }
+
+    PyErr_Fetch(&py_error_type, &py_error_value, &py_error_traceback);
+    if (_pygi_profile_event(tstate, PyTrace_C_EXCEPTION, function) == 0) {
+        PyErr_Restore(py_error_type, py_error_value, py_error_traceback);
+    } else {
+        Py_XDECREF(py_error_type);
+        Py_XDECREF(py_error_value);
+        Py_XDECREF(py_error_traceback);
+    }
+}
@@ -0,0 +1,48 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-profile.h: profiler events for introspected calls.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_PROFILE_H__
+#define __PYGI_PROFILE_H__
+
+#include <Python.h>
+
+#include <girepository.h>
+
+G_BEGIN_DECLS
+
+/* Private */
+
+/* Whether the thread is being profiled, as the interpreter checks it
+ * before C calls.  Threads without a frame have no one to report to. */
+#define _pygi_profile_active(tstate) \
+    G_UNLIKELY((tstate)->use_tracing && (tstate)->c_profilefunc != NULL \
+               && (tstate)->frame != NULL)
+
+PyObject *_pygi_profile_call (PyThreadState *tstate,
+                              GIBaseInfo    *info,
+                              PyObject     **function);
+void _pygi_profile_return (PyThreadState *tstate,
+                           PyObject      *function,
+                           gboolean       failed);
+
+G_END_DECLS
+
+#endif /* __PYGI_PROFILE_H__ */
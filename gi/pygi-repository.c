@@ -210,12 +210,107 @@ _wrap_g_irepository_get_typelib_path (PyGIRepository *self,
     return PyString_FromString(typelib_path);
 }
 
+/* Reads the typelib files of the namespace which the repository would
+ * consider loading, so that they are in the page cache by the time
+ * g_irepository_require() maps them with the GIL held. */
+static void
+_prefetch_typelibs (gchar      **directories,
+                    const gchar *typelib_path,
+                    const gchar *namespace_,
+                    const gchar *version)
+{
+    gchar *prefix;
+    gchar *contents;
+    gsize i;
+
+    if (typelib_path != NULL) {
+        if (g_file_get_contents(typelib_path, &contents, NULL, NULL)) {
+            g_free(contents);
+        }
+        return;
+    }
+
+    /* Without a version, any of the versions may be picked. */
+    prefix = g_strconcat(namespace_, "-", version, NULL);
+
+    for (i = 0; directories[i] != NULL; i++) {
+        GDir *dir;
+        const gchar *name;
+
+        dir = g_dir_open(directories[i], 0, NULL);
+        if (dir == NULL) {
+            continue;
+        }
+
+        while ((name = g_dir_read_name(dir)) != NULL) {
+            gchar *path;
+
+            if (!g_str_has_prefix(name, prefix) || !g_str_has_suffix(name, ".typelib")) {
+                continue;
+            }
+            if (version != NULL && strlen(name) != strlen(prefix) + strlen(".typelib")) {
+                continue;
+            }
+
+            path = g_build_filename(directories[i], name, NULL);
+            if (g_file_get_contents(path, &contents, NULL, NULL)) {
+                g_free(contents);
+            }
+            g_free(path);
+        }
+
+        g_dir_close(dir);
+    }
+
+    g_free(prefix);
+}
+
+static PyObject *
+_wrap_g_irepository_prefetch (PyGIRepository *self,
+                              PyObject       *args,
+                              PyObject       *kwargs)
+{
+    static char *kwlist[] = { "namespace", "version", NULL };
+    const char *namespace_;
+    const char *version = NULL;
+    gchar *typelib_path;
+    gchar **directories;
+    GSList *search_path;
+    gsize i;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs,
+            "s|z:Repository.prefetch", kwlist, &namespace_, &version)) {
+        return NULL;
+    }
+
+    /* The repository is only looked at with the GIL held; the file system is
+     * walked and read without it. */
+    typelib_path = g_strdup(g_irepository_get_typelib_path(self->repository, namespace_));
+
+    search_path = g_irepository_get_search_path();
+    directories = g_new(gchar *, g_slist_length(search_path) + 1);
+    for (i = 0; search_path != NULL; search_path = search_path->next, i++) {
+        directories[i] = g_strdup(search_path->data);
+    }
+    directories[i] = NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    _prefetch_typelibs(directories, typelib_path, namespace_, version);
+    Py_END_ALLOW_THREADS
+
+    g_strfreev(directories);
+    g_free(typelib_path);
+
+    Py_RETURN_NONE;
+}
+
 static PyMethodDef _PyGIRepository_methods[] = {
     { "get_default", (PyCFunction)_wrap_g_irepository_get_default, METH_STATIC|METH_NOARGS },
     { "require", (PyCFunction)_wrap_g_irepository_require, METH_VARARGS|METH_KEYWORDS },
     { "get_infos", (PyCFunction)_wrap_g_irepository_get_infos, METH_VARARGS|METH_KEYWORDS },
     { "find_by_name", (PyCFunction)_wrap_g_irepository_find_by_name, METH_VARARGS|METH_KEYWORDS },
     { "get_typelib_path", (PyCFunction)_wrap_g_irepository_get_typelib_path, METH_VARARGS|METH_KEYWORDS },
+    { "prefetch", (PyCFunction)_wrap_g_irepository_prefetch, METH_VARARGS|METH_KEYWORDS },
     { NULL, NULL, 0 }
 };
 
@@ -0,0 +1,317 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-stats.c: call statistics for functions and callbacks.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+#include <string.h>
+
+gboolean _pygi_stats_enabled = FALSE;
+gboolean _pygi_stats_histograms_enabled = FALSE;
+
+/* Quantiles given in the histogram snapshots. */
+static const gdouble _pygi_histogram_quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+static const gchar *_pygi_stats_phase_names[_PYGI_STATS_N_PHASES] = {
+    "input",
+    "call",
+    "output"
+};
+
+/* Statistics are kept by qualified name, so that they outlive the infos
+ * and are shared by the infos of the same function. */
+static GHashTable *_pygi_stats = NULL;
+
+PyGIStats *
+_pygi_stats_get (GIBaseInfo *info)
+{
+    gchar *name;
+    PyGIStats *stats;
+
+    name = _pygi_g_callable_info_get_qualified_name((GICallableInfo *)info);
+
+    if (_pygi_stats == NULL) {
+        _pygi_stats = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    }
+
+    stats = g_hash_table_lookup(_pygi_stats, name);
+    if (stats == NULL) {
+        stats = g_new0(PyGIStats, 1);
+        g_hash_table_insert(_pygi_stats, name, stats);
+    } else {
+        g_free(name);
+    }
+
+    return stats;
+}
+
+void
+_pygi_stats_record (PyGIStats     *stats,
+                    const guint64 *times,
+                    gboolean       failed)
+{
+    gsize i;
+
+    stats->n_calls++;
+    if (failed) {
+        stats->n_failures++;
+    }
+
+    for (i = 0; i < _PYGI_STATS_N_PHASES; i++) {
+        stats->total[i] += times[i];
+        if (times[i] > stats->max[i]) {
+            stats->max[i] = times[i];
+        }
+    }
+
+    if (G_UNLIKELY(_pygi_stats_histograms_enabled)) {
+        if (stats->histogram == NULL) {
+            stats->histogram = g_new0(PyGIHistogram, 1);
+        }
+        _pygi_histogram_record(stats->histogram,
+                times[_PYGI_STATS_INPUT] + times[_PYGI_STATS_CALL] + times[_PYGI_STATS_OUTPUT]);
+    }
+}
+
+static inline gsize
+_pygi_histogram_get_index (guint64 value)
+{
+    guint exponent;
+
+    if (value < (1 << _PYGI_HISTOGRAM_SUB_BITS)) {
+        return value;
+    }
+
+    /* Position of the most significant bit, followed by the next bits. */
+    exponent = g_bit_storage(value) - 1;
+    if (exponent > _PYGI_HISTOGRAM_MAX_BITS) {
+        return _PYGI_HISTOGRAM_N_BUCKETS - 1;
+    }
+
+    return ((exponent - _PYGI_HISTOGRAM_SUB_BITS + 1) << _PYGI_HISTOGRAM_SUB_BITS)
+            + (gsize)((value >> (exponent - _PYGI_HISTOGRAM_SUB_BITS))
+                      - (1 << _PYGI_HISTOGRAM_SUB_BITS));
+}
+
+/* The range of the bucket is [lower, lower + width). */
+static void
+_pygi_histogram_get_range (gsize    index,
+                           guint64 *lower,
+                           guint64 *width)
+{
+    guint shift;
+
+    if (index < (1 << _PYGI_HISTOGRAM_SUB_BITS)) {
+        *lower = index;
+        *width = 1;
+        return;
+    }
+
+    shift = (index >> _PYGI_HISTOGRAM_SUB_BITS) - 1;
+    *lower = (guint64)((1 << _PYGI_HISTOGRAM_SUB_BITS)
+            + (index & ((1 << _PYGI_HISTOGRAM_SUB_BITS) - 1))) << shift;
+    *width = (guint64)1 << shift;
+}
+
+void
+_pygi_histogram_record (PyGIHistogram *histogram,
+                        guint64        value)
+{
+    volatile gpointer *count = &histogram->counts[_pygi_histogram_get_index(value)];
+    gpointer old_count;
+
+    do {
+        old_count = g_atomic_pointer_get(count);
+    } while (!g_atomic_pointer_compare_and_exchange(count, old_count,
+                GSIZE_TO_POINTER(GPOINTER_TO_SIZE(old_count) + 1)));
+}
+
+/* A snapshot holds the total count, the quantiles, which are the upper
+ * bounds of the buckets they fall in, and the non-empty buckets as
+ * (lower, upper, count), in seconds.  Snapshots of different threads or
+ * processes can be merged by adding the counts of their buckets. */
+static PyObject *
+_pygi_histogram_as_dict (PyGIHistogram *histogram,
+                         gboolean       reset)
+{
+    guint64 counts[_PYGI_HISTOGRAM_N_BUCKETS];
+    guint64 n_values = 0;
+    guint64 n_seen;
+    guint64 lower, width;
+    gsize i, j;
+    PyObject *py_quantiles = NULL;
+    PyObject *py_buckets = NULL;
+    PyObject *py_histogram = NULL;
+
+    for (i = 0; i < _PYGI_HISTOGRAM_N_BUCKETS; i++) {
+        gpointer count;
+
+        do {
+            count = g_atomic_pointer_get(&histogram->counts[i]);
+        } while (reset && !g_atomic_pointer_compare_and_exchange(&histogram->counts[i],
+                                                                 count, NULL));
+        counts[i] = GPOINTER_TO_SIZE(count);
+        n_values += counts[i];
+    }
+
+    py_quantiles = PyDict_New();
+    py_buckets = PyList_New(0);
+    if (py_quantiles == NULL || py_buckets == NULL) {
+        goto out;
+    }
+
+    n_seen = 0;
+    j = 0;
+    for (i = 0; i < _PYGI_HISTOGRAM_N_BUCKETS; i++) {
+        PyObject *py_bucket;
+
+        if (counts[i] == 0) {
+            continue;
+        }
+
+        _pygi_histogram_get_range(i, &lower, &width);
+
+        py_bucket = Py_BuildValue("(ddK)", lower / 1e9, (lower + width) / 1e9, counts[i]);
+        if (py_bucket == NULL || PyList_Append(py_buckets, py_bucket) < 0) {
+            Py_XDECREF(py_bucket);
+            goto out;
+        }
+        Py_DECREF(py_bucket);
+
+        n_seen += counts[i];
+        for (; j < G_N_ELEMENTS(_pygi_histogram_quantiles)
+                && n_seen >= _pygi_histogram_quantiles[j] * n_values; j++) {
+            PyObject *py_quantile;
+            PyObject *py_value;
+
+            py_quantile = PyFloat_FromDouble(_pygi_histogram_quantiles[j]);
+            py_value = PyFloat_FromDouble((lower + width) / 1e9);
+            if (py_quantile == NULL || py_value == NULL
+                    || PyDict_SetItem(py_quantiles, py_quantile, py_value) < 0) {
+                Py_XDECREF(py_quantile);
+                Py_XDECREF(py_value);
+                goto out;
+            }
+            Py_DECREF(py_quantile);
+            Py_DECREF(py_value);
+        }
+    }
+
+    py_histogram = Py_BuildValue("{s:K,s:O,s:O}", "count", n_values,
+            "quantiles", py_quantiles, "buckets", py_buckets);
+
+out:
+    Py_XDECREF(py_quantiles);
+    Py_XDECREF(py_buckets);
+
+    return py_histogram;
+}
+
+typedef struct {
+    PyObject *py_dict;
+    gboolean reset;
+    gboolean failed;
+} PyGIStatsAsDict;
+
+static void
+_pygi_stats_add_to_dict (gpointer key,
+                         gpointer value,
+                         gpointer user_data)
+{
+    PyGIStats *stats = value;
+    PyGIStatsAsDict *as_dict = user_data;
+    PyObject *py_stats;
+    gsize i;
+
+    if (as_dict->failed || stats->n_calls == 0) {
+        return;
+    }
+
+    py_stats = Py_BuildValue("{s:K,s:K}", "calls", stats->n_calls, "failures", stats->n_failures);
+    if (py_stats == NULL) {
+        as_dict->failed = TRUE;
+        return;
+    }
+
+    /* (cumulative, max) in seconds. */
+    for (i = 0; i < _PYGI_STATS_N_PHASES; i++) {
+        PyObject *py_times;
+
+        py_times = Py_BuildValue("(dd)", stats->total[i] / 1e9, stats->max[i] / 1e9);
+        if (py_times == NULL
+                || PyDict_SetItemString(py_stats, _pygi_stats_phase_names[i], py_times) < 0) {
+            Py_XDECREF(py_times);
+            Py_DECREF(py_stats);
+            as_dict->failed = TRUE;
+            return;
+        }
+        Py_DECREF(py_times);
+    }
+
+    if (stats->histogram != NULL) {
+        PyObject *py_histogram;
+
+        py_histogram = _pygi_histogram_as_dict(stats->histogram, as_dict->reset);
+        if (py_histogram == NULL
+                || PyDict_SetItemString(py_stats, "histogram", py_histogram) < 0) {
+            Py_XDECREF(py_histogram);
+            Py_DECREF(py_stats);
+            as_dict->failed = TRUE;
+            return;
+        }
+        Py_DECREF(py_histogram);
+    }
+
+    if (PyDict_SetItemString(as_dict->py_dict, key, py_stats) < 0) {
+        as_dict->failed = TRUE;
+    }
+    Py_DECREF(py_stats);
+
+    if (as_dict->reset) {
+        stats->n_calls = 0;
+        stats->n_failures = 0;
+        memset(stats->total, 0, sizeof(stats->total));
+        memset(stats->max, 0, sizeof(stats->max));
+    }
+}
+
+PyObject *
+_pygi_stats_as_dict (gboolean reset)
+{
+    PyGIStatsAsDict as_dict;
+
+    as_dict.py_dict = PyDict_New();
+    if (as_dict.py_dict == NULL) {
+        return NULL;
+    }
+    as_dict.reset = reset;
+    as_dict.failed = FALSE;
+
+    if (_pygi_stats != NULL) {
+        g_hash_table_foreach(_pygi_stats, _pygi_stats_add_to_dict, &as_dict);
+    }
+
+    if (as_dict.failed) {
+        Py_DECREF(as_dict.py_dict);
+        return NULL;
+    }
+
+    return as_dict.py_dict;
+}
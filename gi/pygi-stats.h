@@ -0,0 +1,96 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-stats.h: call statistics for functions and callbacks.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_STATS_H__
+#define __PYGI_STATS_H__
+
+#include <Python.h>
+
+#include <time.h>
+#include <girepository.h>
+
+G_BEGIN_DECLS
+
+/* For callbacks, the input is the conversion of the arguments to Python,
+ * the call is the one of the Python callable and the output is the
+ * conversion of its return value. */
+typedef enum {
+    _PYGI_STATS_INPUT,
+    _PYGI_STATS_CALL,
+    _PYGI_STATS_OUTPUT,
+    _PYGI_STATS_N_PHASES
+} PyGIStatsPhase;
+
+/* Log-linear buckets of latencies, like HDR histograms: each power of two
+ * is split into 2^_PYGI_HISTOGRAM_SUB_BITS buckets, so that values are
+ * known within 12.5%.  Latencies of 2^(_PYGI_HISTOGRAM_MAX_BITS + 1)
+ * nanoseconds (about 37 minutes) and more go to the last bucket.  Counts
+ * are updated atomically, so that snapshots don't need the GIL. */
+#define _PYGI_HISTOGRAM_SUB_BITS 3
+#define _PYGI_HISTOGRAM_MAX_BITS 40
+#define _PYGI_HISTOGRAM_N_BUCKETS \
+    ((_PYGI_HISTOGRAM_MAX_BITS - _PYGI_HISTOGRAM_SUB_BITS + 2) << _PYGI_HISTOGRAM_SUB_BITS)
+
+typedef struct {
+    /* gsize counts, as pointers for the atomic operations of GLib 2.20. */
+    volatile gpointer counts[_PYGI_HISTOGRAM_N_BUCKETS];
+} PyGIHistogram;
+
+/* Times are in nanoseconds.  Only updated with the GIL held, but for the
+ * histogram. */
+typedef struct {
+    guint64 n_calls;
+    guint64 n_failures;
+    guint64 total[_PYGI_STATS_N_PHASES];
+    guint64 max[_PYGI_STATS_N_PHASES];
+    /* Of the whole latencies, if histograms are enabled. */
+    PyGIHistogram *histogram;
+} PyGIStats;
+
+
+/* Private */
+
+extern gboolean _pygi_stats_enabled;
+extern gboolean _pygi_stats_histograms_enabled;
+
+static inline guint64
+_pygi_stats_now (void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (guint64)now.tv_sec * G_GUINT64_CONSTANT(1000000000) + now.tv_nsec;
+}
+
+PyGIStats *_pygi_stats_get (GIBaseInfo *info);
+void _pygi_stats_record (PyGIStats     *stats,
+                         const guint64 *times,
+                         gboolean       failed);
+
+void _pygi_histogram_record (PyGIHistogram *histogram,
+                             guint64        value);
+
+PyObject *_pygi_stats_as_dict (gboolean reset);
+
+G_END_DECLS
+
+#endif /* __PYGI_STATS_H__ */
@@ -0,0 +1,206 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-steal.c: moving ownership of arguments into the callee.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+#include <pygobject.h>
+
+/* Only boxed types given to the callee can be stolen.  Objects can't: their
+ * wrapper keeps its own reference, so the callee would get a new one, as it
+ * does without gi.steal(). */
+gboolean
+_pygi_steal_check_type_info (GITypeInfo *type_info,
+                             GITransfer  transfer)
+{
+    GIBaseInfo *info;
+    gboolean can_steal = FALSE;
+
+    if (transfer != GI_TRANSFER_EVERYTHING
+            || g_type_info_get_tag(type_info) != GI_TYPE_TAG_INTERFACE) {
+        return FALSE;
+    }
+
+    info = g_type_info_get_interface(type_info);
+
+    switch (g_base_info_get_type(info)) {
+        case GI_INFO_TYPE_BOXED:
+        case GI_INFO_TYPE_STRUCT:
+        {
+            GType type;
+
+            type = g_registered_type_info_get_g_type((GIRegisteredTypeInfo *)info);
+            can_steal = g_type_is_a(type, G_TYPE_BOXED)
+                    && !g_type_is_a(type, G_TYPE_VALUE)
+                    && !g_type_is_a(type, G_TYPE_CLOSURE);
+            break;
+        }
+        default:
+            break;
+    }
+
+    g_base_info_unref(info);
+
+    return can_steal;
+}
+
+/* Stolen wrappers are left without a payload; using them again raises. */
+gboolean
+_pygi_steal_check_not_consumed (PyObject *object)
+{
+    if (PyObject_TypeCheck(object, &PyGBoxed_Type)
+            && ((PyGBoxed *)object)->boxed == NULL) {
+        PyErr_Format(PyExc_ValueError, "this %s was stolen by a previous call",
+                object->ob_type->tp_name);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Nested wrappers and buffers point into the payload, which must stay
+ * where it is while they are alive. */
+gboolean
+_pygi_steal_check_argument (PyObject *object)
+{
+    if (!_pygi_steal_check_not_consumed(object)) {
+        return FALSE;
+    }
+
+    if (_pygi_struct_has_views(object)) {
+        PyErr_Format(PyExc_ValueError, "this %s can't be stolen while views into it are alive",
+                object->ob_type->tp_name);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* The object must have been checked against a type info accepted by
+ * _pygi_steal_check_type_info(), and by _pygi_steal_check_argument(). */
+void
+_pygi_steal_argument (PyObject  *object,
+                      GArgument *arg)
+{
+    PyGBoxed *py_boxed;
+
+    py_boxed = (PyGBoxed *)object;
+
+    /* Views don't own their payload, so it is copied and they stay usable. */
+    if (!py_boxed->free_on_dealloc) {
+        arg->v_pointer = g_boxed_copy(py_boxed->gtype, py_boxed->boxed);
+        return;
+    }
+
+    if (PyObject_TypeCheck(object, &PyGIBoxed_Type)
+            && ((PyGIBoxed *)object)->slice_allocated) {
+        PyGIBoxed *py_gi_boxed = (PyGIBoxed *)object;
+
+        /* Payloads allocated by the constructor are slice-allocated, which
+         * the boxed type can't free, so the callee gets them through its copy
+         * function; the wrapper is consumed all the same. */
+        arg->v_pointer = g_boxed_copy(py_boxed->gtype, py_boxed->boxed);
+        g_slice_free1(py_gi_boxed->size, py_boxed->boxed);
+        py_gi_boxed->slice_allocated = FALSE;
+    } else {
+        arg->v_pointer = py_boxed->boxed;
+    }
+
+    py_boxed->boxed = NULL;
+    py_boxed->free_on_dealloc = FALSE;
+}
+
+static PyObject *
+_steal_new (PyTypeObject *type,
+            PyObject     *args,
+            PyObject     *kwargs)
+{
+    static char *kwlist[] = { "object", NULL };
+
+    PyObject *object;
+    PyGISteal *self;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O:Steal.__new__",
+            kwlist, &object)) {
+        return NULL;
+    }
+
+    if (!PyObject_TypeCheck(object, &PyGBoxed_Type)) {
+        PyErr_Format(PyExc_TypeError, "must be a boxed wrapper, not %s",
+                object->ob_type->tp_name);
+        return NULL;
+    }
+
+    self = (PyGISteal *)type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(object);
+    self->object = object;
+
+    return (PyObject *)self;
+}
+
+static void
+_steal_dealloc (PyGISteal *self)
+{
+    Py_CLEAR(self->object);
+
+    self->ob_type->tp_free((PyObject *)self);
+}
+
+PyTypeObject PyGISteal_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0,
+    "gi.Steal",                                /* tp_name */
+    sizeof(PyGISteal),                         /* tp_basicsize */
+    0,                                         /* tp_itemsize */
+    (destructor)_steal_dealloc,                /* tp_dealloc */
+    (printfunc)NULL,                           /* tp_print */
+    (getattrfunc)NULL,                         /* tp_getattr */
+    (setattrfunc)NULL,                         /* tp_setattr */
+    (cmpfunc)NULL,                             /* tp_compare */
+    (reprfunc)NULL,                            /* tp_repr */
+    NULL,                                      /* tp_as_number */
+    NULL,                                      /* tp_as_sequence */
+    NULL,                                      /* tp_as_mapping */
+    (hashfunc)NULL,                            /* tp_hash */
+    (ternaryfunc)NULL,                         /* tp_call */
+    (reprfunc)NULL,                            /* tp_str */
+    (getattrofunc)NULL,                        /* tp_getattro */
+    (setattrofunc)NULL,                        /* tp_setattro */
+    NULL,                                      /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags */
+};
+
+void
+_pygi_steal_register_types (PyObject *m)
+{
+    if (_pygobject_import() < 0)
+        return;
+
+    PyGISteal_Type.ob_type = &PyType_Type;
+    PyGISteal_Type.tp_new = (newfunc)_steal_new;
+    if (PyType_Ready(&PyGISteal_Type))
+        return;
+    if (PyModule_AddObject(m, "Steal", (PyObject *)&PyGISteal_Type))
+        return;
+}
@@ -0,0 +1,54 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-steal.h: moving ownership of arguments into the callee.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_STEAL_H__
+#define __PYGI_STEAL_H__
+
+#include <Python.h>
+
+#include <girepository.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *object;
+} PyGISteal;
+
+
+/* Private */
+
+extern PyTypeObject PyGISteal_Type;
+
+#define _pygi_steal_check(object) PyObject_TypeCheck(object, &PyGISteal_Type)
+
+gboolean _pygi_steal_check_type_info (GITypeInfo *type_info,
+                                      GITransfer  transfer);
+gboolean _pygi_steal_check_not_consumed (PyObject *object);
+gboolean _pygi_steal_check_argument (PyObject *object);
+void _pygi_steal_argument (PyObject  *object,
+                           GArgument *arg);
+
+void _pygi_steal_register_types (PyObject *m);
+
+G_END_DECLS
+
+#endif /* __PYGI_STEAL_H__ */
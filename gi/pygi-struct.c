@@ -33,6 +33,11 @@ _struct_dealloc (PyGIStruct *self)
 
     PyObject_ClearWeakRefs((PyObject *)self);
 
+    _pygi_struct_set_parent((PyObject *)self, NULL);
+
+    PYGI_PROBE3(struct__free, ((PyObject *)self)->ob_type->tp_name,
+            ((PyGPointer *)self)->pointer, self->free_on_dealloc);
+
     if (self->free_on_dealloc) {
         g_free(((PyGPointer *)self)->pointer);
     }
@@ -40,23 +45,33 @@ _struct_dealloc (PyGIStruct *self)
     ((PyGPointer *)self)->ob_type->tp_free((PyObject *)self);
 }
 
+static int
+_struct_traverse (PyGIStruct *self,
+                  visitproc  visit,
+                  void      *arg)
+{
+    Py_VISIT(self->parent);
+    return 0;
+}
+
+static int
+_struct_clear (PyGIStruct *self)
+{
+    _pygi_struct_set_parent((PyObject *)self, NULL);
+    return 0;
+}
+
 static PyObject *
 _struct_new (PyTypeObject *type,
              PyObject     *args,
              PyObject     *kwargs)
 {
-    static char *kwlist[] = { NULL };
-
     GIBaseInfo *info;
-    gboolean is_simple;
-    gsize size;
+    PyGIStructLayout *layout;
+    gboolean has_values;
     gpointer pointer;
     PyObject *self = NULL;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "", kwlist)) {
-        return NULL;
-    }
-
     info = _pygi_object_get_gi_info((PyObject *)type, &PyGIStructInfo_Type);
     if (info == NULL) {
         if (PyErr_ExceptionMatches(PyExc_AttributeError)) {
@@ -65,8 +80,17 @@ _struct_new (PyTypeObject *type,
         return NULL;
     }
 
-    size = g_struct_info_get_size((GIStructInfo *)info);
-    pointer = g_try_malloc0(size);
+    layout = _pygi_struct_layout_get((GIStructInfo *)info);
+
+    /* Simple structs can be initialized from their field values. */
+    has_values = PyTuple_GET_SIZE(args) > 0 || (kwargs != NULL && PyDict_Size(kwargs) > 0);
+    if (has_values && !layout->is_simple) {
+        PyErr_Format(PyExc_TypeError, "%s() takes no arguments, as it is not a simple structure",
+                type->tp_name);
+        goto out;
+    }
+
+    pointer = g_try_malloc0(layout->size);
     if (pointer == NULL) {
         PyErr_NoMemory();
         goto out;
@@ -75,6 +99,11 @@ _struct_new (PyTypeObject *type,
     self = _pygi_struct_new(type, pointer, TRUE);
     if (self == NULL) {
         g_free(pointer);
+        goto out;
+    }
+
+    if (has_values && _pygi_fields_update(self, args, kwargs) < 0) {
+        Py_CLEAR(self);
     }
 
 out:
@@ -113,11 +142,12 @@ PyTypeObject PyGIStruct_Type = {
     (reprfunc)NULL,                            /* tp_str */
     (getattrofunc)NULL,                        /* tp_getattro */
     (setattrofunc)NULL,                        /* tp_setattro */
-    NULL,                                      /* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,  /* tp_flags */
+    &_pygi_struct_as_buffer,                   /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE |
+        Py_TPFLAGS_HAVE_NEWBUFFER | Py_TPFLAGS_HAVE_GC, /* tp_flags */
     NULL,                                     /* tp_doc */
-    (traverseproc)NULL,                       /* tp_traverse */
-    (inquiry)NULL,                            /* tp_clear */
+    (traverseproc)_struct_traverse,           /* tp_traverse */
+    (inquiry)_struct_clear,                   /* tp_clear */
     (richcmpfunc)NULL,                        /* tp_richcompare */
     0,                                        /* tp_weaklistoffset */
     (getiterfunc)NULL,                        /* tp_iter */
@@ -151,10 +181,79 @@ _pygi_struct_new (PyTypeObject *type,
     ((PyGPointer *)self)->gtype = g_type;
     ((PyGPointer *)self)->pointer = pointer;
     self->free_on_dealloc = free_on_dealloc;
+    self->parent = NULL;
+    self->n_views = 0;
+
+    PYGI_PROBE3(struct__new, type->tp_name, pointer, free_on_dealloc);
 
     return (PyObject *)self;
 }
 
+static gint *
+_pygi_struct_get_n_views (PyObject *object)
+{
+    if (PyObject_TypeCheck(object, &PyGIStruct_Type)) {
+        return &((PyGIStruct *)object)->n_views;
+    } else if (PyObject_TypeCheck(object, &PyGIBoxed_Type)) {
+        return &((PyGIBoxed *)object)->n_views;
+    }
+
+    return NULL;
+}
+
+/* Count a wrapper or a buffer pointing into the memory of object. */
+void
+_pygi_struct_add_view (PyObject *object,
+                       gint      delta)
+{
+    gint *n_views;
+
+    n_views = _pygi_struct_get_n_views(object);
+    if (n_views != NULL) {
+        *n_views += delta;
+        g_assert(*n_views >= 0);
+    }
+}
+
+gboolean
+_pygi_struct_has_views (PyObject *object)
+{
+    gint *n_views;
+
+    n_views = _pygi_struct_get_n_views(object);
+
+    return n_views != NULL && *n_views > 0;
+}
+
+void
+_pygi_struct_set_parent (PyObject *view,
+                         PyObject *parent)
+{
+    PyObject **parent_pointer;
+    PyObject *old_parent;
+
+    if (PyObject_TypeCheck(view, &PyGIStruct_Type)) {
+        parent_pointer = &((PyGIStruct *)view)->parent;
+    } else if (PyObject_TypeCheck(view, &PyGIBoxed_Type)) {
+        parent_pointer = &((PyGIBoxed *)view)->parent;
+    } else {
+        return;
+    }
+
+    if (parent != NULL) {
+        Py_INCREF(parent);
+        _pygi_struct_add_view(parent, 1);
+    }
+
+    old_parent = *parent_pointer;
+    *parent_pointer = parent;
+
+    if (old_parent != NULL) {
+        _pygi_struct_add_view(old_parent, -1);
+        Py_DECREF(old_parent);
+    }
+}
+
 void
 _pygi_struct_register_types (PyObject *m)
 {
@@ -162,6 +261,8 @@ _pygi_struct_register_types (PyObject *m)
     PyGIStruct_Type.tp_base = &PyGPointer_Type;
     PyGIStruct_Type.tp_new = (newfunc)_struct_new;
     PyGIStruct_Type.tp_init = (initproc)_struct_init;
+    /* PyGPointer is not collectable. */
+    PyGIStruct_Type.tp_free = PyObject_GC_Del;
     if (PyType_Ready(&PyGIStruct_Type))
         return;
     if (PyModule_AddObject(m, "Struct", (PyObject *)&PyGIStruct_Type))
@@ -33,6 +33,12 @@ _pygi_struct_new (PyTypeObject *type,
                   gpointer      pointer,
                   gboolean      free_on_dealloc);
 
+void _pygi_struct_set_parent (PyObject *view,
+                              PyObject *parent);
+void _pygi_struct_add_view (PyObject *object,
+                            gint      delta);
+gboolean _pygi_struct_has_views (PyObject *object);
+
 void _pygi_struct_register_types (PyObject *m);
 
 G_END_DECLS
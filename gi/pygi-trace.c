@@ -0,0 +1,302 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-trace.c: recording of invocations for replay.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "pygi-private.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* A trace starts with the magic, followed by records, all little-endian:
+ *
+ *   'F' id:u32 length:u16 name          defines the id of a function
+ *   'C' id:u32 duration:u64 flags:u8    a call, which took duration
+ *       n_args:u8 args                  nanoseconds
+ *
+ * The only flag is _PYGI_TRACE_FAILED.  Arguments are the Python objects
+ * given to FunctionInfo.invoke(), as a tag followed by the value:
+ *
+ *   'N'                                 None
+ *   'T', 'F'                            True, False
+ *   'i' value:i64                       int or long
+ *   'd' value:f64                       float
+ *   's' length:u32 bytes                str
+ *   'u' length:u32 bytes                unicode, in UTF-8
+ *   'l' n_items:u32 items               list
+ *   't' n_items:u32 items               tuple
+ *   '?' length:u16 type name            anything else, not replayable
+ *
+ * Instances, including the one methods are called on, are not replayable,
+ * nor are items nested more than _PYGI_TRACE_MAX_DEPTH sequences deep.
+ *
+ * gi/trace.py reads and replays them. */
+#define _PYGI_TRACE_MAGIC "PYGITRC\1"
+#define _PYGI_TRACE_FAILED 1
+#define _PYGI_TRACE_MAX_DEPTH 32
+
+FILE *_pygi_trace_file = NULL;
+
+/* Ids of the functions defined in the trace, by qualified name. */
+static GHashTable *_pygi_trace_ids = NULL;
+
+/* Children forked without exec record to the file name suffixed with their
+ * process id, like the ones importing gi again. */
+static gchar *_pygi_trace_filename = NULL;
+static gboolean _pygi_trace_atfork_registered = FALSE;
+
+static inline void
+_pygi_trace_write (gconstpointer data,
+                   gsize         size)
+{
+    fwrite(data, size, 1, _pygi_trace_file);
+}
+
+static inline void
+_pygi_trace_write_u8 (guint8 value)
+{
+    putc(value, _pygi_trace_file);
+}
+
+static inline void
+_pygi_trace_write_u16 (guint16 value)
+{
+    value = GUINT16_TO_LE(value);
+    _pygi_trace_write(&value, sizeof(value));
+}
+
+static inline void
+_pygi_trace_write_u32 (guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    _pygi_trace_write(&value, sizeof(value));
+}
+
+static inline void
+_pygi_trace_write_u64 (guint64 value)
+{
+    value = GUINT64_TO_LE(value);
+    _pygi_trace_write(&value, sizeof(value));
+}
+
+static void
+_pygi_trace_write_opaque (PyObject *object)
+{
+    const gchar *type_name = object->ob_type->tp_name;
+    gsize length = MIN(strlen(type_name), G_MAXUINT16);
+
+    _pygi_trace_write_u8('?');
+    _pygi_trace_write_u16(length);
+    _pygi_trace_write(type_name, length);
+}
+
+static void
+_pygi_trace_write_object (PyObject *object,
+                          guint     depth)
+{
+    if (depth > _PYGI_TRACE_MAX_DEPTH) {
+        _pygi_trace_write_opaque(object);
+    } else if (object == Py_None) {
+        _pygi_trace_write_u8('N');
+    } else if (PyBool_Check(object)) {
+        _pygi_trace_write_u8(object == Py_True ? 'T' : 'F');
+    } else if (PyInt_Check(object) || PyLong_Check(object)) {
+        PY_LONG_LONG value;
+
+        value = PyLong_AsLongLong(object);
+        if (value == -1 && PyErr_Occurred()) {
+            PyErr_Clear();
+            _pygi_trace_write_opaque(object);
+            return;
+        }
+
+        _pygi_trace_write_u8('i');
+        _pygi_trace_write_u64((guint64)value);
+    } else if (PyFloat_Check(object)) {
+        union {
+            gdouble d;
+            guint64 u;
+        } value;
+
+        value.d = PyFloat_AS_DOUBLE(object);
+
+        _pygi_trace_write_u8('d');
+        _pygi_trace_write_u64(value.u);
+    } else if (PyString_Check(object)) {
+        _pygi_trace_write_u8('s');
+        _pygi_trace_write_u32(PyString_GET_SIZE(object));
+        _pygi_trace_write(PyString_AS_STRING(object), PyString_GET_SIZE(object));
+    } else if (PyUnicode_Check(object)) {
+        PyObject *py_bytes;
+
+        py_bytes = PyUnicode_AsUTF8String(object);
+        if (py_bytes == NULL) {
+            PyErr_Clear();
+            _pygi_trace_write_opaque(object);
+            return;
+        }
+
+        _pygi_trace_write_u8('u');
+        _pygi_trace_write_u32(PyString_GET_SIZE(py_bytes));
+        _pygi_trace_write(PyString_AS_STRING(py_bytes), PyString_GET_SIZE(py_bytes));
+
+        Py_DECREF(py_bytes);
+    } else if (PyList_Check(object) || PyTuple_Check(object)) {
+        Py_ssize_t i, length;
+
+        length = PySequence_Fast_GET_SIZE(object);
+
+        _pygi_trace_write_u8(PyList_Check(object) ? 'l' : 't');
+        _pygi_trace_write_u32(length);
+        for (i = 0; i < length; i++) {
+            _pygi_trace_write_object(PySequence_Fast_GET_ITEM(object, i), depth + 1);
+        }
+    } else {
+        _pygi_trace_write_opaque(object);
+    }
+}
+
+static gboolean
+_pygi_trace_open (const gchar *filename)
+{
+    _pygi_trace_file = fopen(filename, "wb");
+    if (_pygi_trace_file == NULL) {
+        return FALSE;
+    }
+
+    _pygi_trace_write(_PYGI_TRACE_MAGIC, sizeof(_PYGI_TRACE_MAGIC) - 1);
+
+    _pygi_trace_ids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    _pygi_trace_filename = g_strdup(filename);
+
+    return TRUE;
+}
+
+static void
+_pygi_trace_close (void)
+{
+    fclose(_pygi_trace_file);
+    _pygi_trace_file = NULL;
+
+    g_hash_table_destroy(_pygi_trace_ids);
+    _pygi_trace_ids = NULL;
+
+    g_free(_pygi_trace_filename);
+    _pygi_trace_filename = NULL;
+}
+
+/* Flush the records before forking, so that the child has none of them
+ * buffered and closing its copy of the file writes nothing. */
+static void
+_pygi_trace_atfork_prepare (void)
+{
+    if (_pygi_trace_file != NULL) {
+        fflush(_pygi_trace_file);
+    }
+}
+
+static void
+_pygi_trace_atfork_child (void)
+{
+    gchar *filename;
+
+    if (_pygi_trace_file == NULL) {
+        return;
+    }
+
+    filename = g_strdup_printf("%s.%d", _pygi_trace_filename, (int)getpid());
+    _pygi_trace_close();
+
+    /* The child is not recorded if its file can't be created. */
+    _pygi_trace_open(filename);
+    g_free(filename);
+}
+
+gboolean
+_pygi_trace_start (const gchar *filename)
+{
+    if (_pygi_trace_file != NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "a trace is already being recorded");
+        return FALSE;
+    }
+
+    if (!_pygi_trace_open(filename)) {
+        PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)filename);
+        return FALSE;
+    }
+
+    if (!_pygi_trace_atfork_registered) {
+        pthread_atfork(_pygi_trace_atfork_prepare, NULL, _pygi_trace_atfork_child);
+        _pygi_trace_atfork_registered = TRUE;
+    }
+
+    return TRUE;
+}
+
+/* Returns whether a trace was being recorded. */
+gboolean
+_pygi_trace_stop (void)
+{
+    if (_pygi_trace_file == NULL) {
+        return FALSE;
+    }
+
+    _pygi_trace_close();
+
+    return TRUE;
+}
+
+/* The GIL must be held, and an exception set by the call kept. */
+void
+_pygi_trace_record (const gchar *name,
+                    PyObject    *py_args,
+                    guint64      duration,
+                    gboolean     failed)
+{
+    PyObject *py_error_type, *py_error_value, *py_error_traceback;
+    gpointer id;
+    Py_ssize_t i, n_args;
+
+    if (!g_hash_table_lookup_extended(_pygi_trace_ids, name, NULL, &id)) {
+        gsize length = MIN(strlen(name), G_MAXUINT16);
+
+        id = GUINT_TO_POINTER(g_hash_table_size(_pygi_trace_ids));
+        g_hash_table_insert(_pygi_trace_ids, g_strdup(name), id);
+
+        _pygi_trace_write_u8('F');
+        _pygi_trace_write_u32(GPOINTER_TO_UINT(id));
+        _pygi_trace_write_u16(length);
+        _pygi_trace_write(name, length);
+    }
+
+    n_args = MIN(PyTuple_GET_SIZE(py_args), G_MAXUINT8);
+
+    _pygi_trace_write_u8('C');
+    _pygi_trace_write_u32(GPOINTER_TO_UINT(id));
+    _pygi_trace_write_u64(duration);
+    _pygi_trace_write_u8(failed ? _PYGI_TRACE_FAILED : 0);
+    _pygi_trace_write_u8(n_args);
+
+    PyErr_Fetch(&py_error_type, &py_error_value, &py_error_traceback);
+    for (i = 0; i < n_args; i++) {
+        _pygi_trace_write_object(PyTuple_GET_ITEM(py_args, i), 0);
+    }
+    PyErr_Restore(py_error_type, py_error_value, py_error_traceback);
+}
@@ -0,0 +1,48 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   pygi-trace.h: recording of invocations for replay.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef __PYGI_TRACE_H__
+#define __PYGI_TRACE_H__
+
+#include <Python.h>
+
+#include <stdio.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Private */
+
+extern FILE *_pygi_trace_file;
+
+#define _pygi_trace_active() G_UNLIKELY(_pygi_trace_file != NULL)
+
+gboolean _pygi_trace_start (const gchar *filename);
+gboolean _pygi_trace_stop (void);
+
+void _pygi_trace_record (const gchar *name,
+                         PyObject    *py_args,
+                         guint64      duration,
+                         gboolean     failed);
+
+G_END_DECLS
+
+#endif /* __PYGI_TRACE_H__ */
@@ -33,21 +33,30 @@ typedef struct {
     GIRepository *repository;
 } PyGIRepository;
 
+typedef struct _PyGIInvokePlan PyGIInvokePlan;
+
 typedef struct {
     PyObject_HEAD
     GIBaseInfo *info;
     PyObject *inst_weakreflist;
+    PyGIInvokePlan *plan;
 } PyGIBaseInfo;
 
 typedef struct {
     PyGPointer base;
     gboolean free_on_dealloc;
+    /* Set when the pointer is into the memory of another wrapper. */
+    PyObject *parent;
+    /* Wrappers and buffers pointing into the memory of this one. */
+    gint n_views;
 } PyGIStruct;
 
 typedef struct {
     PyGBoxed base;
     gboolean slice_allocated;
     gsize size;
+    PyObject *parent;
+    gint n_views;
 } PyGIBoxed;
 
 
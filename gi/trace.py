@@ -0,0 +1,267 @@
+# -*- Mode: Python; py-indent-offset: 4 -*-
+# vim: tabstop=4 shiftwidth=4 expandtab
+#
+#   trace.py: recording of invocations and their replay as a benchmark.
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+# USA
+
+"""Record the calls made through FunctionInfo.invoke() to a file, and
+replay them against the same typelibs:
+
+    PYGI_TRACE=calls.trace python application.py
+    python -m gi.trace [-n REPEAT] calls.trace
+
+Child processes importing gi inherit PYGI_TRACE, and record to a file of
+their own, suffixed with their process id, such as calls.trace.1234.
+
+Instances are not recorded, so calls to methods can't be replayed.
+
+The format of the file is described in pygi-trace.c.
+"""
+
+from __future__ import absolute_import
+
+import os
+import sys
+import struct
+import atexit
+
+from ._gi import _start_trace, _stop_trace
+
+
+MAGIC = 'PYGITRC\1'
+FAILED = 1
+
+
+def start(filename):
+    """Record the calls to the file until stop() is called."""
+    _start_trace(filename)
+
+def stop():
+    """Stop recording, and return whether calls were being recorded."""
+    return _stop_trace()
+
+def _start_from_environment():
+    filename = os.environ.get('PYGI_TRACE')
+    if not filename:
+        return
+
+    # Don't truncate the trace of the process which started recording.
+    owner = os.environ.get('PYGI_TRACE_PID')
+    if owner is None:
+        os.environ['PYGI_TRACE_PID'] = str(os.getpid())
+    elif owner != str(os.getpid()):
+        filename = '%s.%d' % (filename, os.getpid())
+
+    start(filename)
+    atexit.register(stop)
+
+
+class Opaque(object):
+    """Stands for an argument which was not recorded."""
+
+    def __init__(self, type_name):
+        self.type_name = type_name
+
+    def __repr__(self):
+        return '<opaque %s>' % self.type_name
+
+
+class Call(object):
+
+    def __init__(self, name, duration, failed, args):
+        self.name = name
+        self.duration = duration
+        self.failed = failed
+        self.args = args
+
+    def is_replayable(self):
+        return not _contains_opaque(self.args)
+
+
+def _contains_opaque(value):
+    if isinstance(value, Opaque):
+        return True
+    if isinstance(value, (list, tuple)):
+        for item in value:
+            if _contains_opaque(item):
+                return True
+    return False
+
+
+class _Reader(object):
+
+    def __init__(self, file_):
+        self.file = file_
+
+    def read(self, size):
+        data = self.file.read(size)
+        if len(data) != size:
+            raise ValueError('truncated trace')
+        return data
+
+    def unpack(self, format):
+        format = '<' + format
+        values = struct.unpack(format, self.read(struct.calcsize(format)))
+        if len(values) == 1:
+            return values[0]
+        return values
+
+    def read_object(self):
+        tag = self.read(1)
+        if tag == 'N':
+            return None
+        elif tag == 'T':
+            return True
+        elif tag == 'F':
+            return False
+        elif tag == 'i':
+            return self.unpack('q')
+        elif tag == 'd':
+            return self.unpack('d')
+        elif tag == 's':
+            return self.read(self.unpack('I'))
+        elif tag == 'u':
+            return self.read(self.unpack('I')).decode('utf-8')
+        elif tag in ('l', 't'):
+            items = [self.read_object() for i in range(self.unpack('I'))]
+            if tag == 't':
+                return tuple(items)
+            return items
+        elif tag == '?':
+            return Opaque(self.read(self.unpack('H')))
+        raise ValueError('unknown argument tag %r' % tag)
+
+
+def read(filename):
+    """Iterate over the calls recorded in the file."""
+    file_ = open(filename, 'rb')
+    try:
+        reader = _Reader(file_)
+        if file_.read(len(MAGIC)) != MAGIC:
+            raise ValueError('%s is not a trace' % filename)
+
+        names = {}
+        while True:
+            kind = file_.read(1)
+            if not kind:
+                break
+            if kind == 'F':
+                id_, length = reader.unpack('IH')
+                names[id_] = reader.read(length)
+            elif kind == 'C':
+                id_, duration, flags, n_args = reader.unpack('IQBB')
+                args = tuple([reader.read_object() for i in range(n_args)])
+                yield Call(names[id_], duration / 1e9, bool(flags & FAILED), args)
+            else:
+                raise ValueError('unknown record %r' % kind)
+    finally:
+        file_.close()
+
+
+def lookup_info(name):
+    """Return the FunctionInfo of the function of the qualified name."""
+    namespace, _, rest = name.partition('.')
+    value = __import__('gi.repository.%s' % namespace, fromlist=[namespace])
+    for part in rest.split('.'):
+        value = getattr(value, part)
+    return getattr(value, 'im_func', value).__info__
+
+
+def replay(filename, repeat=1, timer=None):
+    """Replay the calls of the trace repeat times.
+
+    Calls with arguments which were not recorded, such as instances, are
+    skipped: this includes every call to a method.  Returns, by function,
+    the number of calls replayed, skipped and failing, the time they were
+    recorded to take and the best time they took over the repetitions, in
+    seconds.
+    """
+    if timer is None:
+        import timeit
+        timer = timeit.default_timer
+
+    calls = []
+    results = {}
+    infos = {}
+
+    for call in read(filename):
+        result = results.get(call.name)
+        if result is None:
+            result = results[call.name] = dict(calls=0, skipped=0, failed=0,
+                                               recorded=0.0, replayed=None)
+        if not call.is_replayable():
+            result['skipped'] += 1
+            continue
+        info = infos.get(call.name)
+        if info is None:
+            try:
+                info = infos[call.name] = lookup_info(call.name)
+            except (ImportError, AttributeError):
+                result['skipped'] += 1
+                continue
+        result['calls'] += 1
+        result['recorded'] += call.duration
+        calls.append((result, info.invoke, call.args))
+
+    for i in range(repeat):
+        times = {}
+        for result, invoke, args in calls:
+            start = timer()
+            try:
+                invoke(*args)
+            except Exception:
+                if i == 0:
+                    result['failed'] += 1
+            times[id(result)] = times.get(id(result), 0.0) + timer() - start
+        for result in results.values():
+            time = times.get(id(result))
+            if time is not None and (result['replayed'] is None or time < result['replayed']):
+                result['replayed'] = time
+
+    return results
+
+
+def main(argv):
+    from optparse import OptionParser
+
+    parser = OptionParser(usage='%prog [-n REPEAT] TRACE')
+    parser.add_option('-n', '--repeat', type='int', default=1,
+                      help='replay the trace REPEAT times, keeping the best times')
+    options, args = parser.parse_args(argv[1:])
+    if len(args) != 1:
+        parser.error('a trace is needed')
+
+    results = replay(args[0], options.repeat)
+
+    print '%-60s %8s %8s %8s %12s %12s' % ('function', 'calls', 'skipped', 'failed',
+                                           'recorded', 'replayed')
+    names = results.keys()
+    names.sort()
+    for name in names:
+        result = results[name]
+        replayed = result['replayed']
+        if replayed is None:
+            replayed = '-'
+        else:
+            replayed = '%.6f' % replayed
+        print '%-60s %8d %8d %8d %12.6f %12s' % (name, result['calls'], result['skipped'],
+                                                 result['failed'], result['recorded'],
+                                                 replayed)
+
+
+if __name__ == '__main__':
+    main(sys.argv)
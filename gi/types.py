@@ -29,6 +29,7 @@ from ._gi import \
     InterfaceInfo, \
     ObjectInfo, \
     StructInfo, \
+    FieldDescriptor, \
     set_object_has_new_constructor, \
     register_interface_info
 
@@ -44,6 +45,17 @@ def Function(info):
     return function
 
 
+def FutureFunction(info):
+
+    def future(*args):
+        return info.invoke_future(*args)
+    future.__info__ = info
+    future.__name__ = info.get_name()[:-len('_async')] + '_future'
+    future.__module__ = info.get_namespace()
+
+    return future
+
+
 def Constructor(info):
 
     def constructor(cls, *args):
@@ -69,7 +81,9 @@ class MetaClassHelper(object):
                 setattr(cls, name, constructor)
 
     def _setup_methods(cls):
-        for method_info in cls.__info__.get_methods():
+        method_infos = cls.__info__.get_methods()
+        names = set(method_info.get_name() for method_info in method_infos)
+        for method_info in method_infos:
             name = method_info.get_name()
             function = Function(method_info)
             if method_info.is_method():
@@ -80,10 +94,20 @@ class MetaClassHelper(object):
                 method = staticmethod(function)
             setattr(cls, name, method)
 
+            # foo_async and foo_finish pairs also get foo_future.
+            if name.endswith('_async') and name[:-len('_async')] + '_finish' in names:
+                future = FutureFunction(method_info)
+                if not method_info.is_method():
+                    future = staticmethod(future)
+                setattr(cls, name[:-len('_async')] + '_future', future)
+
     def _setup_fields(cls):
+        fields = []
         for field_info in cls.__info__.get_fields():
-            name = field_info.get_name().replace('-', '_')
-            setattr(cls, name, property(field_info.get_value, field_info.set_value))
+            field = FieldDescriptor(field_info, cls)
+            setattr(cls, field.__name__, field)
+            fields.append(field)
+        cls.__fields__ = tuple(fields)
 
     def _setup_constants(cls):
         for constant_info in cls.__info__.get_constants():
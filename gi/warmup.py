@@ -0,0 +1,88 @@
+# -*- Mode: Python; py-indent-offset: 4 -*-
+# vim: tabstop=4 shiftwidth=4 expandtab
+#
+#   warmup.py: ahead-of-time loading of namespaces, wrappers and invocation plans.
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+# USA
+
+from __future__ import absolute_import
+
+import threading
+
+from ._gi import Repository, FunctionInfo
+
+
+repository = Repository.get_default()
+
+
+def _lookup(path):
+    namespace, _, rest = path.partition('.')
+    value = __import__('gi.repository.%s' % namespace, fromlist=[namespace])
+    for name in rest.split('.') if rest else ():
+        value = getattr(value, name)
+    return value
+
+def _prepare_function(function):
+    function = getattr(function, 'im_func', function)
+    info = getattr(function, '__info__', None)
+    if isinstance(info, FunctionInfo):
+        info.prepare()
+
+def _prepare_class(cls):
+    for name in cls.__dict__.keys():
+        try:
+            value = getattr(cls, name)
+        except AttributeError:
+            continue
+        _prepare_function(value)
+
+def _prewarm(namespaces, classes, functions):
+    for namespace in namespaces:
+        # Read the typelib while the GIL is released, so that require()
+        # finds it in the page cache.
+        repository.prefetch(namespace)
+        repository.require(namespace)
+        _lookup(namespace)
+
+    for path in classes:
+        _prepare_class(_lookup(path))
+
+    for path in functions:
+        _prepare_function(_lookup(path))
+
+
+def prewarm(namespaces, classes=(), functions=(), background=False):
+    """Load namespaces, build wrapper classes and compile invocation plans
+    before they are first used.
+
+    Classes and functions are given by their dotted names, such as
+    'Gtk.Window' or 'Gtk.Window.show'; the methods of each class are
+    prepared as well. With background=True, the work is done in a daemon
+    thread, which is returned so that callers can join it.
+    """
+    namespaces = tuple(namespaces)
+    classes = tuple(classes)
+    functions = tuple(functions)
+
+    if not background:
+        _prewarm(namespaces, classes, functions)
+        return None
+
+    thread = threading.Thread(target=_prewarm, name='gi.prewarm',
+            args=(namespaces, classes, functions))
+    thread.daemon = True
+    thread.start()
+    return thread
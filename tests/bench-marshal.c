@@ -0,0 +1,448 @@
+/* -*- Mode: C; c-basic-offset: 4 -*-
+ * vim: tabstop=4 shiftwidth=4 expandtab
+ *
+ *   bench-marshal.c: timing of the marshalling entry points, from C.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+/* For each type, converts a value with the marshalling functions exported
+ * in gi._gi._marshal_API, and calls a GIMarshallingTests function taking it through
+ * FunctionInfo.invoke(), in loops which don't run any bytecode.  Times are
+ * given per iteration, with the time stamp counter and the cycles and
+ * instructions counted by the CPU where they are available. */
+
+#ifdef HAVE_CONFIG_H
+#   include <config.h>
+#endif
+
+#include <Python.h>
+
+#define NO_IMPORT_PYGOBJECT
+#include <pygi.h>
+#include <pygi-marshal-api.h>
+
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#   include <linux/perf_event.h>
+#   include <sys/ioctl.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
+#if defined(HAVE_X86INTRIN_H) && (defined(__x86_64__) || defined(__i386__))
+#   include <x86intrin.h>
+#   define HAVE_RDTSC 1
+#endif
+
+typedef struct {
+    const gchar *name;
+    /* The function of GIMarshallingTests whose first argument gives the
+     * type, and which checks that it is given the value. */
+    const gchar *function;
+    const gchar *value;
+} BenchCase;
+
+static const BenchCase bench_cases[] = {
+    { "boolean", "boolean_in_true", "True" },
+    { "int8", "int8_in_max", "127" },
+    { "uint8", "uint8_in", "255" },
+    { "int16", "int16_in_max", "32767" },
+    { "uint16", "uint16_in", "65535" },
+    { "int32", "int32_in_max", "2 ** 31 - 1" },
+    { "uint32", "uint32_in", "2 ** 32 - 1" },
+    { "int64", "int64_in_max", "2 ** 63 - 1" },
+    { "uint64", "uint64_in", "2 ** 64 - 1" },
+    { "float", "float_in", "gobject.constants.G_MAXFLOAT" },
+    { "double", "double_in", "gobject.constants.G_MAXDOUBLE" },
+    { "time_t", "time_t_in", "datetime.datetime.fromtimestamp(1234567890)" },
+    { "gtype", "gtype_in", "gobject.TYPE_NONE" },
+    { "utf8", "utf8_none_in", "'const \\xe2\\x99\\xa5 utf8'" },
+    { "array_fixed", "array_fixed_int_in", "(-1, 0, 1, 2)" },
+    { "array", "array_in", "(-1, 0, 1, 2)" },
+    { "array_zero_terminated", "array_zero_terminated_in", "('0', '1', '2')" },
+    { "glist", "glist_utf8_none_in", "('0', '1', '2')" },
+    { "gslist", "gslist_utf8_none_in", "('0', '1', '2')" },
+    { "ghashtable", "ghashtable_utf8_none_in", "{'-1': '1', '0': '0', '1': '-1', '2': '-2'}" },
+    { "gvalue", "gvalue_in", "42" },
+    { "enum", "enum_in", "GIMarshallingTests.Enum.VALUE3" },
+    { "flags", "flags_in", "GIMarshallingTests.Flags.VALUE2" },
+    { "struct", "simple_struct_in", "GIMarshallingTests.SimpleStruct(long_=6, int8=7)" },
+    { "boxed", "boxed_struct_in", "GIMarshallingTests.BoxedStruct(long_=42)" },
+    { "object", "object_none_in", "GIMarshallingTests.Object(int=42)" },
+};
+
+typedef enum {
+    BENCH_FROM_OBJECT,
+    BENCH_TO_OBJECT,
+    BENCH_INVOKE,
+    BENCH_N_KINDS
+} BenchKind;
+
+static const gchar *bench_kind_names[BENCH_N_KINDS] = {
+    "from_object",
+    "to_object",
+    "invoke"
+};
+
+/* Totals of a run. */
+typedef struct {
+    guint64 ns;
+    guint64 ticks;
+    guint64 cycles;
+    guint64 instructions;
+} BenchSample;
+
+static gint n_iterations = 100000;
+static gint n_runs = 5;
+
+static gint perf_fd = -1;
+
+static inline guint64
+bench_now (void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (guint64)now.tv_sec * G_GUINT64_CONSTANT(1000000000) + now.tv_nsec;
+}
+
+static inline guint64
+bench_ticks (void)
+{
+#ifdef HAVE_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* Count the cycles and the instructions of the process in user space, in
+ * a group led by the cycles.  It may not be allowed. */
+static void
+bench_counters_open (void)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    struct perf_event_attr attr;
+    gint fd;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    perf_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (perf_fd < 0) {
+        return;
+    }
+
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 0;
+
+    fd = syscall(__NR_perf_event_open, &attr, 0, -1, perf_fd, 0);
+    if (fd < 0) {
+        close(perf_fd);
+        perf_fd = -1;
+    }
+#endif
+}
+
+static inline void
+bench_counters_start (void)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    if (perf_fd >= 0) {
+        ioctl(perf_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+static inline void
+bench_counters_stop (BenchSample *sample)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    /* The number of counters, followed by their values. */
+    guint64 values[3];
+
+    if (perf_fd >= 0) {
+        ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        if (read(perf_fd, values, sizeof(values)) == (ssize_t)sizeof(values)) {
+            sample->cycles = values[1];
+            sample->instructions = values[2];
+        }
+    }
+#endif
+}
+
+static gboolean
+bench_run (BenchKind    kind,
+           GITypeInfo  *type_info,
+           PyObject    *py_value,
+           PyObject    *py_invoke,
+           PyObject    *py_args,
+           BenchSample *sample)
+{
+    GArgument arg;
+    PyObject *py_object;
+    guint64 start_ns, start_ticks;
+    gint i;
+
+    memset(sample, 0, sizeof(BenchSample));
+    memset(&arg, 0, sizeof(arg));
+
+    /* The value converted by to_object is made beforehand. */
+    if (kind == BENCH_TO_OBJECT) {
+        arg = pygi_argument_from_object(py_value, type_info, GI_TRANSFER_NOTHING);
+        if (PyErr_Occurred()) {
+            return FALSE;
+        }
+    }
+
+    bench_counters_start();
+    start_ticks = bench_ticks();
+    start_ns = bench_now();
+
+    switch (kind) {
+        case BENCH_FROM_OBJECT:
+            for (i = 0; i < n_iterations; i++) {
+                arg = pygi_argument_from_object(py_value, type_info, GI_TRANSFER_NOTHING);
+                pygi_argument_release(&arg, type_info, GI_TRANSFER_NOTHING, GI_DIRECTION_IN);
+            }
+            break;
+        case BENCH_TO_OBJECT:
+            for (i = 0; i < n_iterations; i++) {
+                py_object = pygi_argument_to_object(&arg, type_info, GI_TRANSFER_NOTHING);
+                Py_XDECREF(py_object);
+            }
+            break;
+        case BENCH_INVOKE:
+            for (i = 0; i < n_iterations; i++) {
+                py_object = PyObject_Call(py_invoke, py_args, NULL);
+                if (py_object == NULL) {
+                    break;
+                }
+                Py_DECREF(py_object);
+            }
+            break;
+        default:
+            g_assert_not_reached();
+    }
+
+    sample->ns = bench_now() - start_ns;
+    sample->ticks = bench_ticks() - start_ticks;
+    bench_counters_stop(sample);
+
+    if (kind == BENCH_TO_OBJECT) {
+        pygi_argument_release(&arg, type_info, GI_TRANSFER_NOTHING, GI_DIRECTION_IN);
+    }
+
+    return !PyErr_Occurred();
+}
+
+static void
+bench_print (const gchar *name,
+             BenchKind    kind,
+             BenchSample *sample)
+{
+    g_print("%-24s %-12s %10.1f", name, bench_kind_names[kind],
+            (gdouble)sample->ns / n_iterations);
+
+#ifdef HAVE_RDTSC
+    g_print(" %10.1f", (gdouble)sample->ticks / n_iterations);
+#else
+    g_print(" %10s", "-");
+#endif
+
+    if (perf_fd >= 0) {
+        g_print(" %10.1f %12.1f\n", (gdouble)sample->cycles / n_iterations,
+                (gdouble)sample->instructions / n_iterations);
+    } else {
+        g_print(" %10s %12s\n", "-", "-");
+    }
+}
+
+static gboolean
+bench_case (const BenchCase *bench_case,
+            PyObject        *py_globals)
+{
+    PyObject *py_info = NULL;
+    PyObject *py_value = NULL;
+    PyObject *py_invoke = NULL;
+    PyObject *py_args = NULL;
+    GIArgInfo *arg_info = NULL;
+    GITypeInfo *type_info = NULL;
+    gchar *expression;
+    gboolean success = FALSE;
+    gint kind;
+
+    expression = g_strdup_printf("GIMarshallingTests.%s.__info__", bench_case->function);
+    py_info = PyRun_String(expression, Py_eval_input, py_globals, py_globals);
+    g_free(expression);
+    if (py_info == NULL) {
+        goto out;
+    }
+
+    py_value = PyRun_String(bench_case->value, Py_eval_input, py_globals, py_globals);
+    if (py_value == NULL) {
+        goto out;
+    }
+
+    py_invoke = PyObject_GetAttrString(py_info, "invoke");
+    py_args = PyTuple_Pack(1, py_value);
+    if (py_invoke == NULL || py_args == NULL) {
+        goto out;
+    }
+
+    arg_info = g_callable_info_get_arg((GICallableInfo *)((PyGIBaseInfo *)py_info)->info, 0);
+    type_info = g_arg_info_get_type(arg_info);
+
+    for (kind = 0; kind < BENCH_N_KINDS; kind++) {
+        BenchSample best, sample;
+        gint i;
+
+        /* Warm the caches and the plans first. */
+        if (!bench_run(kind, type_info, py_value, py_invoke, py_args, &best)) {
+            goto out;
+        }
+
+        for (i = 0; i < n_runs; i++) {
+            if (!bench_run(kind, type_info, py_value, py_invoke, py_args, &sample)) {
+                goto out;
+            }
+            if (i == 0 || sample.ns < best.ns) {
+                best = sample;
+            }
+        }
+
+        bench_print(bench_case->name, kind, &best);
+    }
+
+    success = TRUE;
+
+out:
+    if (type_info != NULL) {
+        g_base_info_unref((GIBaseInfo *)type_info);
+    }
+    if (arg_info != NULL) {
+        g_base_info_unref((GIBaseInfo *)arg_info);
+    }
+    Py_XDECREF(py_args);
+    Py_XDECREF(py_invoke);
+    Py_XDECREF(py_value);
+    Py_XDECREF(py_info);
+
+    return success;
+}
+
+static gboolean
+bench_case_selected (const BenchCase *bench_case,
+                     gchar          **names)
+{
+    gint i;
+
+    if (names == NULL || names[0] == NULL) {
+        return TRUE;
+    }
+
+    for (i = 0; names[i] != NULL; i++) {
+        if (strstr(bench_case->name, names[i]) != NULL) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+    static gchar **names = NULL;
+    static GOptionEntry entries[] = {
+        { "iterations", 'n', 0, G_OPTION_ARG_INT, &n_iterations,
+          "Number of iterations of a run", "N" },
+        { "runs", 'r', 0, G_OPTION_ARG_INT, &n_runs,
+          "Number of runs of which the best is kept", "N" },
+        { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &names,
+          NULL, "[TYPE...]" },
+        { NULL }
+    };
+
+    GOptionContext *context;
+    GError *error = NULL;
+    PyObject *py_globals;
+    PyObject *py_result;
+    gsize i;
+    int status = 0;
+
+    context = g_option_context_new("- time the marshalling of each type");
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return 2;
+    }
+    g_option_context_free(context);
+
+    if (n_iterations < 1 || n_runs < 1) {
+        g_printerr("iterations and runs must be positive\n");
+        return 2;
+    }
+
+    Py_Initialize();
+
+    py_globals = PyDict_New();
+    PyDict_SetItemString(py_globals, "__builtins__", PyEval_GetBuiltins());
+    py_result = PyRun_String("import datetime\n"
+                             "import gobject\n"
+                             "from gi.repository import GIMarshallingTests\n",
+                             Py_file_input, py_globals, py_globals);
+    if (py_result == NULL || pygi_import() < 0 || pygi_marshal_import() < 0) {
+        PyErr_Print();
+        return 1;
+    }
+    Py_DECREF(py_result);
+
+    bench_counters_open();
+
+    g_print("%-24s %-12s %10s %10s %10s %12s\n", "type", "entry point", "ns", "ticks",
+            "cycles", "instructions");
+
+    for (i = 0; i < G_N_ELEMENTS(bench_cases); i++) {
+        if (!bench_case_selected(&bench_cases[i], names)) {
+            continue;
+        }
+        if (!bench_case(&bench_cases[i], py_globals)) {
+            g_printerr("%s: ", bench_cases[i].name);
+            PyErr_Print();
+            status = 1;
+        }
+    }
+
+    Py_DECREF(py_globals);
+
+    Py_Finalize();
+
+    return status;
+}
@@ -0,0 +1,300 @@
+#!/usr/bin/env python
+# -*- Mode: Python; py-indent-offset: 4 -*-
+# vim: tabstop=4 shiftwidth=4 expandtab
+
+"""Time the calls of GIMarshallingTests, one case per type and direction.
+
+Results are given in nanoseconds per call, the best of several runs.  They
+can be saved as JSON with --output, and compared against a saved file with
+--baseline, in which case the exit status tells whether a case got slower
+than the tolerance allows.
+"""
+
+import pygtk
+pygtk.require("2.0")
+
+import gobject
+
+from datetime import datetime
+from optparse import OptionParser
+import timeit
+import sys
+sys.path.insert(0, "../")
+
+try:
+    import json
+except ImportError:
+    import simplejson as json
+
+from gi.repository import GIMarshallingTests, Everything
+
+
+CONSTANT_UTF8 = "const \xe2\x99\xa5 utf8"
+
+INTS = (-1, 0, 1, 2)
+UTF8S = ('0', '1', '2')
+INT_HASH = {-1: 1, 0: 0, 1: -1, 2: -2}
+UTF8_HASH = {'-1': '1', '0': '0', '1': '-1', '2': '-2'}
+
+# The functions check that they are given these values.
+LIMITS = {
+    'int8': (gobject.G_MININT8, gobject.G_MAXINT8),
+    'int16': (gobject.G_MININT16, gobject.G_MAXINT16),
+    'int32': (gobject.G_MININT32, gobject.G_MAXINT32),
+    'int64': (- (2 ** 63), 2 ** 63 - 1),
+    'short': (gobject.constants.G_MINSHORT, gobject.constants.G_MAXSHORT),
+    'int': (gobject.constants.G_MININT, gobject.constants.G_MAXINT),
+    'long': (gobject.constants.G_MINLONG, gobject.constants.G_MAXLONG),
+    'ssize': (gobject.constants.G_MINLONG, gobject.constants.G_MAXLONG),
+}
+
+UNSIGNED_MAXIMUMS = {
+    'uint8': gobject.G_MAXUINT8,
+    'uint16': gobject.G_MAXUINT16,
+    'uint32': gobject.G_MAXUINT32,
+    'uint64': 2 ** 64 - 1,
+    'ushort': gobject.constants.G_MAXUSHORT,
+    'uint': gobject.constants.G_MAXUINT,
+    'ulong': gobject.constants.G_MAXULONG,
+    'size': gobject.constants.G_MAXULONG,
+}
+
+DATETIME = datetime.fromtimestamp(1234567890)
+
+
+def get_cases():
+    """Return (name, function, args) for each case."""
+    cases = []
+
+    def add(name, *args):
+        cases.append((name, getattr(GIMarshallingTests, name), args))
+
+    # Scalars.
+    for value in ('true', 'false'):
+        add('boolean_return_%s' % value)
+        add('boolean_out_%s' % value)
+        add('boolean_in_%s' % value, value == 'true')
+    add('boolean_inout_true_false', True)
+    add('boolean_inout_false_true', False)
+
+    for type_, (min_, max_) in LIMITS.items():
+        for bound, value in (('max', max_), ('min', min_)):
+            add('%s_return_%s' % (type_, bound))
+            add('%s_out_%s' % (type_, bound))
+            add('%s_in_%s' % (type_, bound), value)
+        add('%s_inout_max_min' % type_, max_)
+        add('%s_inout_min_max' % type_, min_)
+
+    for type_, max_ in UNSIGNED_MAXIMUMS.items():
+        add('%s_return' % type_)
+        add('%s_out' % type_)
+        add('%s_in' % type_, max_)
+        add('%s_inout' % type_, max_)
+
+    for type_, max_ in (('float', gobject.constants.G_MAXFLOAT),
+                        ('double', gobject.constants.G_MAXDOUBLE)):
+        add('%s_return' % type_)
+        add('%s_out' % type_)
+        add('%s_in' % type_, max_)
+        add('%s_inout' % type_, max_)
+
+    add('time_t_return')
+    add('time_t_out')
+    add('time_t_in', DATETIME)
+    add('time_t_inout', DATETIME)
+
+    add('gtype_return')
+    add('gtype_out')
+    add('gtype_in', gobject.TYPE_NONE)
+    add('gtype_inout', gobject.TYPE_NONE)
+
+    # Strings.
+    for transfer in ('none', 'full'):
+        add('utf8_%s_return' % transfer)
+        add('utf8_%s_out' % transfer)
+        add('utf8_%s_in' % transfer, CONSTANT_UTF8)
+        add('utf8_%s_inout' % transfer, CONSTANT_UTF8)
+
+    # Arrays.
+    add('array_fixed_int_return')
+    add('array_fixed_short_return')
+    add('array_fixed_int_in', INTS)
+    add('array_fixed_short_in', INTS)
+    add('array_fixed_out')
+    add('array_fixed_out_struct')
+    add('array_fixed_inout', INTS)
+    add('array_return')
+    add('array_in', INTS)
+    add('array_out')
+    add('array_inout', INTS)
+    add('array_zero_terminated_return')
+    add('array_zero_terminated_in', UTF8S)
+    add('array_zero_terminated_out')
+    add('array_zero_terminated_inout', UTF8S)
+
+    # Containers.
+    for container in ('glist', 'gslist'):
+        add('%s_int_none_return' % container)
+        add('%s_int_none_in' % container, INTS)
+        for transfer in ('none', 'container', 'full'):
+            add('%s_utf8_%s_return' % (container, transfer))
+            add('%s_utf8_%s_in' % (container, transfer), UTF8S)
+            add('%s_utf8_%s_out' % (container, transfer))
+            add('%s_utf8_%s_inout' % (container, transfer), UTF8S)
+
+    add('ghashtable_int_none_return')
+    add('ghashtable_int_none_in', INT_HASH)
+    for transfer in ('none', 'container', 'full'):
+        add('ghashtable_utf8_%s_return' % transfer)
+        add('ghashtable_utf8_%s_in' % transfer, UTF8_HASH)
+        add('ghashtable_utf8_%s_out' % transfer)
+        add('ghashtable_utf8_%s_inout' % transfer, UTF8_HASH)
+
+    add('gvalue_return')
+    add('gvalue_in', 42)
+    add('gvalue_out')
+    add('gvalue_inout', 42)
+
+    # Enumerations.
+    add('enum_in', GIMarshallingTests.Enum.VALUE3)
+    add('enum_out')
+    add('enum_inout', GIMarshallingTests.Enum.VALUE3)
+    add('flags_in', GIMarshallingTests.Flags.VALUE2)
+    add('flags_out')
+    add('flags_inout', GIMarshallingTests.Flags.VALUE2)
+
+    # Structures.  The inout functions change the structure they are
+    # given, so its fields are set again before each call, which is timed
+    # too.
+    simple_struct = GIMarshallingTests.SimpleStruct()
+    simple_struct.long_ = 6
+    simple_struct.int8 = 7
+    add('simple_struct_return')
+    add('simple_struct_in', simple_struct)
+    add('simple_struct_out')
+    def simple_struct_inout(struct):
+        struct.long_ = 6
+        struct.int8 = 7
+        GIMarshallingTests.simple_struct_inout(struct)
+    cases.append(('simple_struct_inout', simple_struct_inout,
+                  (GIMarshallingTests.SimpleStruct(),)))
+
+    for type_ in ('pointer', 'boxed'):
+        struct = getattr(GIMarshallingTests, '%sStruct' % type_.capitalize())()
+        struct.long_ = 42
+        add('%s_struct_return' % type_)
+        add('%s_struct_in' % type_, struct)
+        add('%s_struct_out' % type_)
+        def struct_inout(struct, function=getattr(GIMarshallingTests, '%s_struct_inout' % type_)):
+            struct.long_ = 42
+            function(struct)
+        cases.append(('%s_struct_inout' % type_, struct_inout, (struct.__class__(),)))
+
+    # Objects.
+    object_ = GIMarshallingTests.Object(int = 42)
+    for transfer in ('none', 'full'):
+        add('object_%s_return' % transfer)
+        add('object_%s_in' % transfer, object_)
+        add('object_%s_out' % transfer)
+    add('object_none_inout', object_)
+
+    # Callbacks.
+    add('gclosure_in', lambda: 42)
+    cases.append(('Everything.test_callback', Everything.test_callback, (lambda: 42,)))
+    cases.append(('Everything.test_callback_user_data', Everything.test_callback_user_data,
+                  (lambda data: data, 42)))
+
+    cases.sort()
+
+    return cases
+
+
+def time_case(function, args, repeat, min_time):
+    """Return the best time of a call, in nanoseconds."""
+    timer = timeit.default_timer
+
+    # Find a number of calls which takes long enough to be measured.
+    number = 1
+    while True:
+        start = timer()
+        for i in xrange(number):
+            function(*args)
+        elapsed = timer() - start
+        if elapsed >= min_time:
+            break
+        number *= 10
+
+    best = elapsed
+    for i in range(repeat - 1):
+        start = timer()
+        for i in xrange(number):
+            function(*args)
+        best = min(best, timer() - start)
+
+    return best / number * 1e9
+
+
+def compare(results, baseline, tolerance):
+    """Return (name, baseline, result) for the cases slower than allowed."""
+    regressions = []
+    names = results.keys()
+    names.sort()
+    for name in names:
+        if name not in baseline:
+            continue
+        base = baseline[name]['ns_per_call']
+        current = results[name]['ns_per_call']
+        if current > base * (1 + tolerance):
+            regressions.append((name, base, current))
+    return regressions
+
+
+def main(argv):
+    parser = OptionParser(usage='%prog [options] [NAME...]')
+    parser.add_option('-o', '--output', metavar='FILE',
+                      help='save the results as JSON to FILE')
+    parser.add_option('-b', '--baseline', metavar='FILE',
+                      help='compare the results to those saved in FILE')
+    parser.add_option('-t', '--tolerance', type='float', default=0.1,
+                      help='slowdown allowed by the comparison, as a fraction [default: %default]')
+    parser.add_option('-r', '--repeat', type='int', default=5,
+                      help='number of timed runs per case [default: %default]')
+    parser.add_option('-m', '--min-time', type='float', default=0.02,
+                      help='minimum duration of a run, in seconds [default: %default]')
+    options, names = parser.parse_args(argv[1:])
+
+    results = {}
+    for name, function, args in get_cases():
+        if names and not [n for n in names if n in name]:
+            continue
+        ns_per_call = time_case(function, args, options.repeat, options.min_time)
+        results[name] = {
+            'ns_per_call': round(ns_per_call, 1),
+            'calls_per_second': int(1e9 / ns_per_call),
+        }
+        print '%-50s %12.1f ns' % (name, ns_per_call)
+
+    if options.output:
+        output = open(options.output, 'w')
+        try:
+            json.dump({'python': sys.version.split()[0], 'results': results}, output,
+                      indent=2, sort_keys=True)
+            output.write('\n')
+        finally:
+            output.close()
+
+    if options.baseline:
+        baseline = json.load(open(options.baseline))['results']
+        regressions = compare(results, baseline, options.tolerance)
+        for name, base, current in regressions:
+            print '%-50s %12.1f ns -> %.1f ns (+%.0f%%)' % (name, base, current,
+                                                           (current / base - 1) * 100)
+        if regressions:
+            print '%d of %d cases are slower than the baseline' % (len(regressions), len(results))
+            return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
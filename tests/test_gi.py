@@ -9,9 +9,13 @@ import gobject
 
 from datetime import datetime
 
+import gc
+import os
 import sys
+import tempfile
 sys.path.insert(0, "../")
 
+import gi
 from gi.repository import GIMarshallingTests, Everything
 
 
@@ -940,6 +944,12 @@ class TestGEnum(unittest.TestCase):
         self.assertTrue(isinstance(enum, GIMarshallingTests.Enum))
         self.assertEquals(enum, GIMarshallingTests.Enum.VALUE1)
 
+    def test_enum_identity(self):
+        self.assertTrue(GIMarshallingTests.enum_out() is GIMarshallingTests.Enum.VALUE3)
+        self.assertTrue(GIMarshallingTests.Enum(42) is GIMarshallingTests.Enum.VALUE3)
+        # The singletons are those of pygobject.
+        self.assertTrue(GIMarshallingTests.enum_out() is GIMarshallingTests.Enum.__enum_values__[42])
+
 
 class TestGFlags(unittest.TestCase):
 
@@ -967,6 +977,12 @@ class TestGFlags(unittest.TestCase):
         self.assertTrue(isinstance(flags, GIMarshallingTests.Flags))
         self.assertEquals(flags, GIMarshallingTests.Flags.VALUE1)
 
+    def test_flags_identity(self):
+        self.assertTrue(GIMarshallingTests.flags_out() is GIMarshallingTests.Flags.VALUE2)
+        self.assertTrue(GIMarshallingTests.flags_out() is GIMarshallingTests.flags_out())
+        self.assertTrue(GIMarshallingTests.flags_out() is
+                GIMarshallingTests.Flags.__flags_values__[int(GIMarshallingTests.Flags.VALUE2)])
+
 
 class TestStructure(unittest.TestCase):
 
@@ -987,6 +1003,70 @@ class TestStructure(unittest.TestCase):
 
         del struct
 
+    def test_simple_struct_field_descriptor(self):
+        descriptor = GIMarshallingTests.SimpleStruct.__dict__['long_']
+        self.assertTrue(isinstance(descriptor, gi._gi.FieldDescriptor))
+        self.assertTrue(GIMarshallingTests.SimpleStruct.long_ is descriptor)
+
+        struct = GIMarshallingTests.SimpleStruct()
+        descriptor.__set__(struct, 42)
+        self.assertEquals(42, struct.long_)
+
+        self.assertRaises(TypeError, setattr, struct, 'long_', 'a')
+        self.assertRaises(TypeError, delattr, struct, 'long_')
+        self.assertRaises(TypeError, descriptor.__get__, object())
+
+    def test_simple_struct_bulk(self):
+        struct = GIMarshallingTests.SimpleStruct(6, int8=7)
+        self.assertEquals((6, 7), gi.fields_as_tuple(struct))
+        self.assertEquals({'long_': 6, 'int8': 7}, gi.fields_as_dict(struct))
+
+        gi.fields_update(struct, int8=-1)
+        self.assertEquals((6, -1), gi.fields_as_tuple(struct))
+
+        self.assertRaises(TypeError, GIMarshallingTests.SimpleStruct, 1, 2, 3)
+        self.assertRaises(TypeError, GIMarshallingTests.SimpleStruct, 1, long_=2)
+        self.assertRaises(TypeError, gi.fields_update, struct, foo=1)
+        self.assertRaises(TypeError, GIMarshallingTests.NotSimpleStruct, None)
+        self.assertRaises(TypeError, gi.fields_as_tuple, object())
+        self.assertRaises(TypeError, gi.fields_update)
+
+    def test_bulk_fields_and_methods(self):
+        from gi.repository import GLib
+
+        # The bulk accessors don't hide introspected methods of the same name.
+        self.assertFalse(hasattr(GIMarshallingTests.SimpleStruct, 'update'))
+        self.assertEquals('update', GLib.Checksum.update.__info__.get_name())
+
+    def test_simple_struct_buffer(self):
+        struct = GIMarshallingTests.SimpleStruct(6, 7)
+        view = memoryview(struct)
+        self.assertEquals(0, view.ndim)
+        self.assertTrue(view.format.startswith('=T{'))
+
+        # Arrays stay tuples unless asked for.
+        array = GIMarshallingTests.array_fixed_out_struct()
+        self.assertTrue(isinstance(array, tuple))
+        self.assertEquals([(7, 6), (6, 7)], [gi.fields_as_tuple(item) for item in array])
+        self.assertTrue(isinstance(array[0], GIMarshallingTests.SimpleStruct))
+
+        gi.set_struct_arrays_enabled(True)
+        try:
+            buffer_ = GIMarshallingTests.array_fixed_out_struct()
+        finally:
+            gi.set_struct_arrays_enabled(False)
+        self.assertTrue(isinstance(buffer_, gi._gi.StructArray))
+        self.assertEquals(array[0].long_, buffer_[0].long_)
+        view = memoryview(buffer_)
+        self.assertEquals((2,), view.shape)
+        self.assertEquals(2 * view.itemsize, len(view.tobytes()))
+
+        # Writes through the view land in the structures.
+        view[1:2] = view[0:1]
+        self.assertEquals((7, 6), gi.fields_as_tuple(buffer_[1]))
+
+        self.assertRaises(BufferError, memoryview, GIMarshallingTests.NotSimpleStruct())
+
     def test_nested_struct(self):
         struct = GIMarshallingTests.NestedStruct()
 
@@ -997,6 +1077,36 @@ class TestStructure(unittest.TestCase):
 
         del struct
 
+    def test_nested_struct_view(self):
+        struct = GIMarshallingTests.NestedStruct()
+        simple_struct = struct.simple_struct
+
+        simple_struct.int8 = 5
+        self.assertEquals(5, struct.simple_struct.int8)
+
+        del struct
+        simple_struct.long_ = 42
+        self.assertEquals((42, 5), gi.fields_as_tuple(simple_struct))
+
+    def test_nested_struct_view_cycle(self):
+        import gc
+        import weakref
+
+        struct = GIMarshallingTests.NestedStruct()
+        struct.view = struct.simple_struct
+        ref = weakref.ref(struct)
+
+        del struct
+        gc.collect()
+        self.assertEquals(None, ref())
+
+    def test_nested_struct_assignment(self):
+        struct = GIMarshallingTests.NestedStruct()
+
+        for i in range(3):
+            struct.simple_struct = GIMarshallingTests.SimpleStruct(i, i + 1)
+            self.assertEquals((i, i + 1), gi.fields_as_tuple(struct.simple_struct))
+
     def test_not_simple_struct(self):
         struct = GIMarshallingTests.NotSimpleStruct()
         self.assertEquals(None, struct.pointer)
@@ -1168,6 +1278,51 @@ class TestStructure(unittest.TestCase):
         del out_struct
 
 
+class TestSteal(unittest.TestCase):
+
+    def test_steal_check(self):
+        self.assertRaises(TypeError, gi.steal, 42)
+
+        self.assertRaises(TypeError, gi.steal, GIMarshallingTests.Object())
+
+        boxed = GIMarshallingTests.BoxedStruct()
+        self.assertRaises(TypeError, GIMarshallingTests.int8_in_max, gi.steal(boxed))
+
+    def test_steal(self):
+        # The payload of a wrapper made by a constructor function belongs to
+        # the boxed type, so it is moved into the callee as is.
+        struct = GIMarshallingTests.BoxedStruct.new()
+        struct.long_ = 42
+
+        out_struct = GIMarshallingTests.boxed_struct_inout(gi.steal(struct))
+        self.assertEquals(0, out_struct.long_)
+
+        # The wrapper is left empty.
+        self.assertRaises(ValueError, getattr, struct, 'long_')
+        self.assertRaises(ValueError, GIMarshallingTests.boxed_struct_in, struct)
+        self.assertRaises(ValueError, GIMarshallingTests.boxed_struct_inout, gi.steal(struct))
+
+    def test_steal_constructed(self):
+        struct = GIMarshallingTests.BoxedStruct()
+        struct.long_ = 42
+
+        GIMarshallingTests.boxed_struct_inout(gi.steal(struct))
+        self.assertRaises(ValueError, getattr, struct, 'long_')
+
+    def test_steal_with_views(self):
+        struct = GIMarshallingTests.BoxedStruct.new()
+        struct.long_ = 42
+
+        # The payload can't be moved from under a buffer pointing into it.
+        view = memoryview(struct)
+        self.assertRaises(ValueError, GIMarshallingTests.boxed_struct_inout, gi.steal(struct))
+        self.assertEquals(42, struct.long_)
+        del view
+
+        GIMarshallingTests.boxed_struct_inout(gi.steal(struct))
+        self.assertRaises(ValueError, getattr, struct, 'long_')
+
+
 class TestGObject(unittest.TestCase):
 
     def test_object(self):
@@ -1461,3 +1616,489 @@ class TestCallbacks(unittest.TestCase):
         i = Everything.test_callback_thaw_async();
         self.assertEquals(44, i);
         self.assertTrue(TestCallbacks.called)
+
+    def testCallbackReuse(self):
+        for i in range(5):
+            self.assertEquals(i, Everything.test_callback(lambda: i))
+
+        # The closure went back to the pool.
+        self.assertTrue(gi.trim_free_lists() >= 1)
+        self.assertEquals(44, Everything.test_callback(lambda: 44))
+
+        gi.set_closure_pool_capacity(0)
+        try:
+            Everything.test_callback(lambda: 44)
+            self.assertEquals(0, gi.trim_free_lists())
+        finally:
+            gi.set_closure_pool_capacity(16)
+
+    def testCallbackArguments(self):
+        seen = []
+        def callback(data):
+            seen.append(data)
+            return data
+
+        kept = []
+        def keeping_callback(*args):
+            kept.append(args)
+            return 0
+
+        for i in range(3):
+            self.assertEquals(i, Everything.test_callback_user_data(callback, i))
+            Everything.test_callback_user_data(keeping_callback, i)
+
+        self.assertEquals([0, 1, 2], seen)
+        self.assertEquals([(0,), (1,), (2,)], kept)
+
+    def testCallbackQueued(self):
+        TestCallbacks.called = False
+        def callback():
+            TestCallbacks.called = True
+
+        # Called from the thread holding the GIL, so not queued.
+        Everything.test_simple_callback(gi.queued(callback, coalesce=True))
+        self.assertTrue(TestCallbacks.called)
+        self.assertEquals(0, gi.dispatch_pending())
+
+        self.assertRaises(TypeError, gi.queued, None)
+
+        # Its return value would be lost.
+        self.assertRaises(TypeError, Everything.test_callback,
+                gi.queued(lambda: 1))
+
+    def testCallbackNative(self):
+        import ctypes
+
+        self.assertEquals(GIMarshallingTests.int_return_max(),
+                Everything.test_callback(GIMarshallingTests.int_return_max))
+
+        callback = ctypes.CFUNCTYPE(ctypes.c_int)(lambda: 42)
+        self.assertEquals(42, Everything.test_callback(callback))
+
+        # The prototype must match.
+        wrong_callback = ctypes.CFUNCTYPE(ctypes.c_double)(lambda: 42)
+        self.assertRaises(TypeError, Everything.test_callback, wrong_callback)
+        wrong_callback = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_int)(lambda x: 42)
+        self.assertRaises(TypeError, Everything.test_callback, wrong_callback)
+
+        # Capsules must be named after the callback.
+        capsule_new = ctypes.pythonapi.PyCapsule_New
+        capsule_new.restype = ctypes.py_object
+        capsule_new.argtypes = (ctypes.c_void_p, ctypes.c_char_p, ctypes.c_void_p)
+        address = ctypes.cast(callback, ctypes.c_void_p)
+
+        name = ctypes.c_char_p('Everything.TestCallback')
+        capsule = capsule_new(address, name, None)
+        self.assertEquals(42, Everything.test_callback(capsule))
+
+        wrong_name = ctypes.c_char_p('Everything.TestCallbackUserData')
+        capsule = capsule_new(address, wrong_name, None)
+        self.assertRaises(TypeError, Everything.test_callback, capsule)
+
+        # Untyped C objects aren't trusted.
+        cobject_new = ctypes.pythonapi.PyCObject_FromVoidPtr
+        cobject_new.restype = ctypes.py_object
+        cobject_new.argtypes = (ctypes.c_void_p, ctypes.c_void_p)
+        cobject = cobject_new(address, None)
+        self.assertRaises(TypeError, Everything.test_callback, cobject)
+
+        # Python objects can't be given to native callbacks as user data.
+        callback = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p)(lambda data: 42)
+        self.assertEquals(42, Everything.test_callback_user_data(callback, None))
+        self.assertRaises(TypeError, Everything.test_callback_user_data,
+                callback, object())
+
+    def testCallbackUserDataRefcount(self):
+        user_data = object()
+        refcount = sys.getrefcount(user_data)
+
+        for i in range(10):
+            Everything.test_callback_async(lambda data: 1, user_data)
+            Everything.test_callback_thaw_async()
+        # Async closures are released when the next one is made.
+        Everything.test_simple_callback(lambda: None)
+
+        self.assertEquals(refcount, sys.getrefcount(user_data))
+
+    def testCallbackAsyncReclaimed(self):
+        user_data = object()
+        refcount = sys.getrefcount(user_data)
+
+        Everything.test_callback_async(lambda data: 1, user_data)
+        Everything.test_callback_thaw_async()
+        gi.trim_free_lists()
+
+        self.assertEquals(refcount, sys.getrefcount(user_data))
+
+    def testCallbackAsyncReclaimedWithoutMainLoop(self):
+        user_data = object()
+        refcount = sys.getrefcount(user_data)
+
+        Everything.test_callback_async(lambda data: 1, user_data)
+        Everything.test_callback_thaw_async()
+
+        # Creating the next callback reclaims it.
+        Everything.test_callback(lambda: 1)
+
+        self.assertEquals(refcount, sys.getrefcount(user_data))
+
+    def testCallbackAsyncDrainedWhileRunning(self):
+        user_data = object()
+        refcount = sys.getrefcount(user_data)
+
+        def callback(data):
+            # Its own closure must survive this.
+            gi.trim_free_lists()
+            return 1
+
+        Everything.test_callback_async(callback, user_data)
+        Everything.test_callback_async(callback, user_data)
+        self.assertEquals(1, Everything.test_callback_thaw_async())
+        gi.trim_free_lists()
+
+        self.assertEquals(refcount, sys.getrefcount(user_data))
+
+
+class TestStats(unittest.TestCase):
+
+    def tearDown(self):
+        gi.set_stats_enabled(False)
+        gi._stats(reset=True)
+
+    def test_stats(self):
+        gi._stats(reset=True)
+        GIMarshallingTests.int8_return_max()
+        self.assertEquals({}, gi._stats())
+
+        gi.set_stats_enabled(True)
+        for i in range(3):
+            GIMarshallingTests.int8_return_max()
+        Everything.test_callback(lambda: 1)
+
+        stats = gi._stats(reset=True)
+        function_stats = stats['GIMarshallingTests.int8_return_max']
+        self.assertEquals(3, function_stats['calls'])
+        total, max_ = function_stats['call']
+        self.assertTrue(total >= max_ >= 0)
+        self.assertEquals(1, stats['Everything.TestCallback']['calls'])
+        self.assertEquals(0, function_stats['failures'])
+
+        self.assertEquals({}, gi._stats())
+
+        # Calls failing to convert their arguments are counted too.
+        self.assertRaises(TypeError, GIMarshallingTests.int8_in_max, 'a')
+        self.assertRaises(TypeError, GIMarshallingTests.int8_in_max)
+        GIMarshallingTests.int8_in_max(127)
+        function_stats = gi._stats()['GIMarshallingTests.int8_in_max']
+        self.assertEquals(3, function_stats['calls'])
+        self.assertEquals(2, function_stats['failures'])
+
+    def test_histograms(self):
+        gi._stats(reset=True)
+        gi.set_stats_enabled(True, histograms=True)
+        for i in range(100):
+            GIMarshallingTests.int8_return_max()
+        Everything.test_callback(lambda: 1)
+
+        stats = gi._stats(reset=True)
+        histogram = stats['GIMarshallingTests.int8_return_max']['histogram']
+        self.assertEquals(100, histogram['count'])
+        self.assertEquals(100, sum([count for lower, upper, count in histogram['buckets']]))
+        for lower, upper, count in histogram['buckets']:
+            self.assertTrue(0 <= lower < upper)
+        self.assertEquals([0.5, 0.9, 0.99, 0.999], sorted(histogram['quantiles'].keys()))
+        self.assertTrue(histogram['quantiles'][0.5] <= histogram['quantiles'][0.999])
+        self.assertTrue(histogram['quantiles'][0.999] >= stats['GIMarshallingTests.int8_return_max']['call'][1])
+        self.assertEquals(1, stats['Everything.TestCallback']['histogram']['count'])
+
+        GIMarshallingTests.int8_return_max()
+        stats = gi._stats()
+        self.assertEquals(1, stats['GIMarshallingTests.int8_return_max']['histogram']['count'])
+
+        gi.set_stats_enabled(True)
+        GIMarshallingTests.int8_return_max()
+        stats = gi._stats()
+        self.assertEquals(2, stats['GIMarshallingTests.int8_return_max']['calls'])
+        self.assertEquals(1, stats['GIMarshallingTests.int8_return_max']['histogram']['count'])
+
+
+class TestProfile(unittest.TestCase):
+
+    def test_profile_events(self):
+        events = []
+        def profile(frame, event, arg):
+            if event.startswith('c_') and isinstance(arg.__module__, str):
+                events.append((event, '%s.%s' % (arg.__module__, arg.__name__)))
+
+        sys.setprofile(profile)
+        try:
+            GIMarshallingTests.int8_return_max()
+            GIMarshallingTests.Object(int = 42).method()
+            Everything.test_callback(lambda: 1)
+        finally:
+            sys.setprofile(None)
+
+        self.assertTrue(('c_call', 'GIMarshallingTests.int8_return_max') in events)
+        self.assertTrue(('c_return', 'GIMarshallingTests.int8_return_max') in events)
+        self.assertTrue(('c_call', 'GIMarshallingTests.Object.method') in events)
+        self.assertTrue(('c_call', 'Everything.TestCallback') in events)
+        self.assertTrue(('c_return', 'Everything.TestCallback') in events)
+
+    def test_profile_exception(self):
+        events = []
+        def profile(frame, event, arg):
+            if event.startswith('c_') and arg.__module__ == 'GIMarshallingTests':
+                events.append(event)
+
+        sys.setprofile(profile)
+        try:
+            self.assertRaises(ValueError, GIMarshallingTests.int8_in_max, 128)
+        finally:
+            sys.setprofile(None)
+
+        self.assertEquals(['c_call', 'c_exception'], events)
+
+
+class TestProbes(unittest.TestCase):
+
+    def test_probe_notes(self):
+        if not gi._gi._PROBES_ENABLED:
+            return
+
+        data = open(gi._gi.__file__, 'rb').read()
+
+        # The notes of the probes are in the .note.stapsdt section, each
+        # holding the provider and the probe names.
+        self.assertTrue('.note.stapsdt' in data)
+        for name in ('invoke__entry', 'invoke__return', 'call__start', 'call__done',
+                     'closure__entry', 'closure__return', 'boxed__new', 'boxed__free',
+                     'struct__new', 'struct__free'):
+            self.assertTrue('pygi\0%s\0' % name in data, name)
+
+
+class TestTrace(unittest.TestCase):
+
+    def setUp(self):
+        fd, self.filename = tempfile.mkstemp()
+        os.close(fd)
+
+    def tearDown(self):
+        os.remove(self.filename)
+
+    def test_trace(self):
+        # The suite itself may be recorded.
+        if os.environ.get('PYGI_TRACE'):
+            return
+
+        gi.trace.start(self.filename)
+        try:
+            self.assertRaises(RuntimeError, gi.trace.start, self.filename)
+            GIMarshallingTests.int8_in_max(127)
+            GIMarshallingTests.utf8_none_in(CONSTANT_UTF8)
+            GIMarshallingTests.array_in([-1, 0, 1, 2])
+            self.assertRaises(ValueError, GIMarshallingTests.int8_in_max, 128)
+            GIMarshallingTests.Object(int = 42).method()
+
+            # Deeply nested arguments are cut short.
+            nested = []
+            for i in range(10000):
+                nested = [nested]
+            self.assertRaises(TypeError, GIMarshallingTests.int8_in_max, nested)
+        finally:
+            self.assertTrue(gi.trace.stop())
+        self.assertFalse(gi.trace.stop())
+
+        calls = list(gi.trace.read(self.filename))
+        self.assertEquals(['GIMarshallingTests.int8_in_max', 'GIMarshallingTests.utf8_none_in',
+                           'GIMarshallingTests.array_in', 'GIMarshallingTests.int8_in_max'],
+                          [call.name for call in calls[:4]])
+        self.assertEquals((127,), calls[0].args)
+        self.assertEquals((CONSTANT_UTF8,), calls[1].args)
+        self.assertEquals(([-1, 0, 1, 2],), calls[2].args)
+        self.assertEquals([False, False, False, True], [call.failed for call in calls[:4]])
+        self.assertTrue(calls[0].duration >= 0)
+
+        method_calls = [call for call in calls if call.name == 'GIMarshallingTests.Object.method']
+        self.assertEquals(1, len(method_calls))
+        self.assertFalse(method_calls[0].is_replayable())
+
+        self.assertEquals('GIMarshallingTests.int8_in_max', calls[-1].name)
+        self.assertFalse(calls[-1].is_replayable())
+
+        results = gi.trace.replay(self.filename, repeat=2)
+        self.assertEquals(2, results['GIMarshallingTests.int8_in_max']['calls'])
+        # int8_in_max(128) fails again.
+        self.assertEquals(1, results['GIMarshallingTests.int8_in_max']['failed'])
+        self.assertTrue(results['GIMarshallingTests.int8_in_max']['replayed'] >= 0)
+        self.assertEquals(1, results['GIMarshallingTests.Object.method']['skipped'])
+
+
+    def test_trace_child_process(self):
+        import subprocess
+
+        trace = open(self.filename, 'wb')
+        trace.write('parent')
+        trace.close()
+
+        # The child doesn't truncate the trace of its parent.
+        env = dict(os.environ, PYGI_TRACE=self.filename, PYGI_TRACE_PID='1')
+        child = subprocess.Popen([sys.executable, '-c', 'import gi'], env=env)
+        self.assertEquals(0, child.wait())
+
+        child_filename = '%s.%d' % (self.filename, child.pid)
+        try:
+            self.assertEquals('parent', open(self.filename, 'rb').read())
+            self.assertEquals([], list(gi.trace.read(child_filename)))
+        finally:
+            os.remove(child_filename)
+
+    def test_trace_fork(self):
+        if os.environ.get('PYGI_TRACE'):
+            return
+
+        gi.trace.start(self.filename)
+        try:
+            GIMarshallingTests.int8_in_max(127)
+            pid = os.fork()
+            if pid == 0:
+                try:
+                    GIMarshallingTests.utf8_none_in(CONSTANT_UTF8)
+                    gi.trace.stop()
+                finally:
+                    os._exit(0)
+            os.waitpid(pid, 0)
+            GIMarshallingTests.array_in([-1, 0, 1, 2])
+        finally:
+            gi.trace.stop()
+
+        child_filename = '%s.%d' % (self.filename, pid)
+        try:
+            self.assertEquals(['GIMarshallingTests.int8_in_max', 'GIMarshallingTests.array_in'],
+                              [call.name for call in gi.trace.read(self.filename)])
+            self.assertEquals(['GIMarshallingTests.utf8_none_in'],
+                              [call.name for call in gi.trace.read(child_filename)])
+        finally:
+            os.remove(child_filename)
+
+
+class TestFuture(unittest.TestCase):
+
+    def test_future_requires_callback(self):
+        info = GIMarshallingTests.int8_in_max.__info__
+        self.assertRaises(TypeError, info.invoke_future, 127)
+
+    def test_future_requires_finish(self):
+        self.assertRaises(AttributeError, getattr, GIMarshallingTests, 'int8_future')
+
+    def test_invoke_async(self):
+        future = GIMarshallingTests.int8_return_max.__info__.invoke_async()
+        self.assertEquals(127, future.result())
+        self.assertTrue(future.done())
+        self.assertEquals(None, future.exception())
+
+        results = []
+        future = GIMarshallingTests.int8_in_max.__info__.invoke_async(127)
+        future.add_done_callback(lambda f: results.append(f.result()))
+        future.result()
+        self.assertEquals([None], results)
+
+    def test_invoke_async_bad_arguments(self):
+        info = GIMarshallingTests.int8_in_max.__info__
+        self.assertRaises(TypeError, info.invoke_async)
+
+    def test_future(self):
+        from gi.repository import Gio
+
+        results = []
+        gfile = Gio.file_new_for_path(__file__)
+        future = gfile.read_future(0, None)
+        future.add_done_callback(results.append)
+
+        stream = future.result()
+        self.assertTrue(isinstance(stream, Gio.FileInputStream))
+        self.assertTrue(future.done())
+        self.assertEquals(None, future.exception())
+        self.assertEquals([future], results)
+        stream.close(None)
+
+        # Errors of the _finish function are raised by result().
+        results = []
+        gfile = Gio.file_new_for_path(os.path.join(tempfile.gettempdir(), 'does-not-exist'))
+        future = gfile.read_future(0, None)
+        future.add_done_callback(results.append)
+
+        self.assertRaises(Exception, future.result)
+        self.assertTrue(future.exception() is not None)
+        self.assertEquals([future], results)
+
+        # Done callbacks added afterwards run right away.
+        future.add_done_callback(results.append)
+        self.assertEquals([future, future], results)
+
+    def test_future_gc(self):
+        from gi.repository import Gio
+
+        # Pending callbacks often refer to their future.
+        gfile = Gio.file_new_for_path(__file__)
+        future = gfile.read_future(0, None)
+        callback = lambda f: future
+        future.add_done_callback(callback)
+
+        self.assertTrue(gc.is_tracked(future))
+        self.assertTrue(callback in gc.get_referents(future))
+
+        future.result().close(None)
+
+
+class TestInvokeMany(unittest.TestCase):
+
+    def test_invoke_many(self):
+        info = GIMarshallingTests.int8_return_max.__info__
+        self.assertEquals([127] * 5, info.invoke_many([()] * 5))
+        self.assertEquals([127] * 5, info.invoke_many([()] * 5, chunk_size=2))
+        self.assertEquals(None, info.invoke_many([()] * 5, discard=True))
+
+        info = GIMarshallingTests.int8_in_max.__info__
+        self.assertEquals([None, None], info.invoke_many(iter([(127,), [127]])))
+        self.assertRaises(TypeError, info.invoke_many, [(127,), ()], chunk_size=4)
+        self.assertRaises(ValueError, info.invoke_many, [], chunk_size=0)
+
+        # Chunks are no larger than the calls.
+        self.assertEquals([None], info.invoke_many([(127,)], chunk_size=10 ** 12))
+        self.assertEquals([None], info.invoke_many(iter([(127,)]), chunk_size=2 ** 20))
+
+    def test_invoke_many_bad_discard(self):
+        class Bad(object):
+            def __nonzero__(self):
+                raise ValueError
+
+        info = GIMarshallingTests.int8_return_max.__info__
+        self.assertRaises(ValueError, info.invoke_many, [()], discard=Bad())
+
+
+class TestPrewarm(unittest.TestCase):
+
+    def test_prewarm(self):
+        gi.prewarm(['GIMarshallingTests'],
+                classes=['GIMarshallingTests.SimpleStruct'],
+                functions=['GIMarshallingTests.int8_return_max'])
+        self.assertEquals(127, GIMarshallingTests.int8_return_max())
+
+    def test_prewarm_background(self):
+        thread = gi.prewarm(['GIMarshallingTests'],
+                functions=['GIMarshallingTests.int8_in_max'],
+                background=True)
+        thread.join()
+        GIMarshallingTests.int8_in_max(127)
+
+    def test_prefetch(self):
+        repository = gi._gi.Repository.get_default()
+        repository.prefetch('GIMarshallingTests')
+        # Namespaces which are not loaded are looked up in the search path.
+        repository.prefetch('DoesNotExist')
+        repository.prefetch('DoesNotExist', '1.0')
+
+    def test_prepare(self):
+        info = GIMarshallingTests.int8_return_min.__info__
+        info.prepare()
+        self.assertEquals(-128, info.invoke())